@@ -0,0 +1,240 @@
+#include "capi/bboy.h"
+#include "core/cartridge/rom_image.h"
+#include "core/gameboy.h"
+#include "core/step_runner.h"
+#include <cstring>
+
+struct bboy_gameboy
+{
+  Gameboy gameboy{nullptr};
+  StepRunner stepRunner{gameboy};
+  Accuracy accuracy{Accuracy::accurate};
+  std::vector<uint8> state{};
+};
+
+namespace
+{
+uint8* region(uint8* data, size_t regionSize, size_t* size)
+{
+  if(size) *size = regionSize;
+  return data;
+}
+
+size_t regionSize(std::pair<uint16, uint16> region)
+{
+  return region.second - region.first + 1;
+}
+} //namespace
+
+uint32_t bboy_api_version(void)
+{
+  return BBOY_API_VERSION;
+}
+
+bboy_gameboy* bboy_create(void)
+{
+  try
+  {
+    return new bboy_gameboy{};
+  }
+  catch(...)
+  {
+    return nullptr;
+  }
+}
+
+void bboy_destroy(bboy_gameboy* gameboy)
+{
+  delete gameboy;
+}
+
+int bboy_set_accuracy(bboy_gameboy* gameboy, int accuracy)
+{
+  if(accuracy < BBOY_ACCURACY_ACCURATE || accuracy > BBOY_ACCURACY_FAST) return -1;
+  gameboy->accuracy = static_cast<Accuracy>(accuracy);
+  return 0;
+}
+
+void bboy_set_deterministic(bboy_gameboy* gameboy, int enabled, const uint64_t* ram_seed)
+{
+  gameboy->gameboy.setDeterministic(enabled != 0, ram_seed ? std::optional<uint64_t>{*ram_seed} : std::nullopt);
+}
+
+int bboy_load_rom(bboy_gameboy* gameboy, const uint8_t* data, size_t size)
+{
+  try
+  {
+    std::shared_ptr<const RomImage> rom{RomImage::fromBuffer(data, size)};
+    if(!rom) return -1;
+    gameboy->gameboy.openRom(std::move(rom), "rom", gameboy->accuracy);
+    return gameboy->gameboy.hasRom() ? 0 : -1;
+  }
+  catch(...)
+  {
+    return -1;
+  }
+}
+
+int bboy_load_rom_file(bboy_gameboy* gameboy, const char* path)
+{
+  try
+  {
+    gameboy->gameboy.openRom(std::filesystem::path{path}, gameboy->accuracy);
+    return gameboy->gameboy.hasRom() ? 0 : -1;
+  }
+  catch(...)
+  {
+    return -1;
+  }
+}
+
+void bboy_reset(bboy_gameboy* gameboy)
+{
+  gameboy->gameboy.hardReset();
+}
+
+void bboy_step_frame(bboy_gameboy* gameboy)
+{
+  if(gameboy->gameboy.hasRom()) gameboy->gameboy.frame();
+}
+
+uint32_t bboy_step_cycles(bboy_gameboy* gameboy, uint32_t m_cycles)
+{
+  return gameboy->gameboy.hasRom() ? gameboy->gameboy.runCycles(m_cycles) : 0;
+}
+
+void bboy_set_input(bboy_gameboy* gameboy, uint8_t buttons)
+{
+  gameboy->gameboy.setButtons(buttons);
+}
+
+const uint8_t* bboy_step(bboy_gameboy* gameboy, uint8_t buttons, uint32_t repeat, size_t* size, int* terminal,
+                         int* stopped)
+{
+  const StepRunner::Result result{gameboy->stepRunner.step(buttons, repeat)};
+  if(size) *size = result.observationSize;
+  if(terminal) *terminal = result.terminal;
+  if(stopped) *stopped = result.stopped;
+  return result.observation;
+}
+
+int bboy_set_observation(bboy_gameboy* gameboy, int format, uint32_t downsample)
+{
+  if(format < BBOY_OBSERVATION_NONE || format > BBOY_OBSERVATION_PACKED || downsample > 0xFF) return -1;
+  return gameboy->stepRunner.setObservation(static_cast<StepRunner::Observation>(format), static_cast<uint8>(downsample)) ? 0 : -1;
+}
+
+int bboy_add_terminal(bboy_gameboy* gameboy, uint16_t address, uint8_t mask, int compare, uint8_t value)
+{
+  using Compare = StepRunner::TerminalPredicate::Compare;
+  if(compare < BBOY_COMPARE_EQUAL || compare > BBOY_COMPARE_GREATER) return -1;
+  try
+  {
+    gameboy->stepRunner.addTerminalPredicate({address, mask, static_cast<Compare>(compare), value});
+    return 0;
+  }
+  catch(...)
+  {
+    return -1;
+  }
+}
+
+void bboy_clear_terminals(bboy_gameboy* gameboy)
+{
+  gameboy->stepRunner.clearTerminalPredicates();
+}
+
+uint32_t bboy_add_watchpoint(bboy_gameboy* gameboy, uint16_t first, uint16_t last, int access, int bank, int stop)
+{
+  constexpr int allAccesses{BBOY_WATCH_READ | BBOY_WATCH_WRITE | BBOY_WATCH_EXECUTE};
+  return gameboy->gameboy.getBus().addWatchpoint(
+    {first, last, static_cast<uint8>(access & allAccesses), bank < 0 ? -1 : bank, stop != 0});
+}
+
+void bboy_remove_watchpoint(bboy_gameboy* gameboy, uint32_t id)
+{
+  gameboy->gameboy.getBus().removeWatchpoint(id);
+}
+
+void bboy_clear_watchpoints(bboy_gameboy* gameboy)
+{
+  gameboy->gameboy.getBus().clearWatchpoints();
+}
+
+void bboy_set_watch_callback(bboy_gameboy* gameboy, bboy_watch_callback callback, void* user)
+{
+  if(!callback) gameboy->gameboy.getBus().setWatchCallback({});
+  else
+  {
+    gameboy->gameboy.getBus().setWatchCallback([callback, user](const MMU::WatchHit& hit)
+                                               { callback(user, hit.id, hit.address, hit.access, hit.value, hit.cycle); });
+  }
+}
+
+int bboy_add_cheat(bboy_gameboy* gameboy, const char* code)
+{
+  try
+  {
+    return code && gameboy->gameboy.addCheat(code) ? 0 : -1;
+  }
+  catch(...)
+  {
+    return -1;
+  }
+}
+
+void bboy_clear_cheats(bboy_gameboy* gameboy)
+{
+  gameboy->gameboy.clearCheats();
+}
+
+const uint16_t* bboy_framebuffer(const bboy_gameboy* gameboy)
+{
+  return gameboy->gameboy.getLcdBuffer();
+}
+
+uint8_t* bboy_vram(bboy_gameboy* gameboy, size_t* size)
+{
+  return region(gameboy->gameboy.getBus().getVram(), regionSize(MemoryRegions::vram), size);
+}
+
+uint8_t* bboy_wram(bboy_gameboy* gameboy, size_t* size)
+{
+  return region(gameboy->gameboy.getBus().getWorkRam(), regionSize({MemoryRegions::workRam0.first, MemoryRegions::workRam1.second}), size);
+}
+
+uint8_t* bboy_oam(bboy_gameboy* gameboy, size_t* size)
+{
+  return region(gameboy->gameboy.getBus().getOam(), regionSize(MemoryRegions::oam), size);
+}
+
+uint8_t* bboy_hram(bboy_gameboy* gameboy, size_t* size)
+{
+  return region(gameboy->gameboy.getBus().getHighRam(), regionSize(MemoryRegions::highRam), size);
+}
+
+size_t bboy_save_state(bboy_gameboy* gameboy, uint8_t* buffer, size_t size)
+{
+  try
+  {
+    gameboy->gameboy.saveState(gameboy->state);
+  }
+  catch(...)
+  {
+    return 0;
+  }
+  if(buffer && size >= gameboy->state.size()) std::memcpy(buffer, gameboy->state.data(), gameboy->state.size());
+  return gameboy->state.size();
+}
+
+int bboy_load_state(bboy_gameboy* gameboy, const uint8_t* data, size_t size)
+{
+  try
+  {
+    return gameboy->gameboy.loadState(data, size) ? 0 : -1;
+  }
+  catch(...)
+  {
+    return -1;
+  }
+}
@@ -0,0 +1,132 @@
+#ifndef BBOY_H
+#define BBOY_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* stable c interface over the emulator core for embedding through ffi.
+   every pointer returned here is a view of the live emulator memory, valid until bboy_destroy.
+   no c++ exception crosses this interface, failures are reported through the return values */
+
+#if defined(_WIN32)
+#define BBOY_API __declspec(dllexport)
+#else
+#define BBOY_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BBOY_API_VERSION 7
+#define BBOY_LCD_WIDTH 160
+#define BBOY_LCD_HEIGHT 144
+
+typedef struct bboy_gameboy bboy_gameboy;
+
+enum bboy_button
+{
+  BBOY_BUTTON_A = 1 << 0,
+  BBOY_BUTTON_B = 1 << 1,
+  BBOY_BUTTON_SELECT = 1 << 2,
+  BBOY_BUTTON_START = 1 << 3,
+  BBOY_BUTTON_RIGHT = 1 << 4,
+  BBOY_BUTTON_LEFT = 1 << 5,
+  BBOY_BUTTON_UP = 1 << 6,
+  BBOY_BUTTON_DOWN = 1 << 7,
+};
+
+enum bboy_observation
+{
+  BBOY_OBSERVATION_NONE,
+  BBOY_OBSERVATION_RGB565,    /* 2 bytes per pixel, native endianness */
+  BBOY_OBSERVATION_GRAYSCALE, /* 1 byte per pixel, 255 is white */
+  BBOY_OBSERVATION_PACKED,    /* 2 bit shades (0 is white), 4 pixels per byte starting from the low bits */
+};
+
+enum bboy_compare
+{
+  BBOY_COMPARE_EQUAL,
+  BBOY_COMPARE_NOT_EQUAL,
+  BBOY_COMPARE_LESS,
+  BBOY_COMPARE_GREATER,
+};
+
+enum bboy_accuracy
+{
+  BBOY_ACCURACY_ACCURATE,
+  BBOY_ACCURACY_FAST, /* no bus blocking, scanline renderer, no lcd re-enable delay */
+};
+
+enum bboy_watch
+{
+  BBOY_WATCH_READ = 1 << 0,
+  BBOY_WATCH_WRITE = 1 << 1,
+  BBOY_WATCH_EXECUTE = 1 << 2, /* opcode fetches */
+};
+
+/* access is a single bboy_watch flag, value is the byte read, written or fetched */
+typedef void (*bboy_watch_callback)(void* user, uint32_t id, uint16_t address, int access, uint8_t value,
+                                    uint64_t cycle);
+
+BBOY_API uint32_t bboy_api_version(void);
+
+BBOY_API bboy_gameboy* bboy_create(void); /* null on failure */
+BBOY_API void bboy_destroy(bboy_gameboy* gameboy);
+
+/* applied by the next rom load, 0 on success */
+BBOY_API int bboy_set_accuracy(bboy_gameboy* gameboy, int accuracy); /* bboy_accuracy */
+/* no .sav files and audio independent from the host, so a rom and its inputs always give the same state.
+   when ram_seed is not null work and high ram start as noise from that seed instead of cleared. applied by the next rom load */
+BBOY_API void bboy_set_deterministic(bboy_gameboy* gameboy, int enabled, const uint64_t* ram_seed);
+/* the rom is copied, returns 0 on success */
+BBOY_API int bboy_load_rom(bboy_gameboy* gameboy, const uint8_t* data, size_t size);
+BBOY_API int bboy_load_rom_file(bboy_gameboy* gameboy, const char* path);
+BBOY_API void bboy_reset(bboy_gameboy* gameboy);
+
+BBOY_API void bboy_step_frame(bboy_gameboy* gameboy);
+BBOY_API uint32_t bboy_step_cycles(bboy_gameboy* gameboy, uint32_t m_cycles); /* fewer when a watchpoint stopped it */
+BBOY_API void bboy_set_input(bboy_gameboy* gameboy, uint8_t buttons); /* bboy_button flags */
+
+/* holds the buttons for repeat frames and only renders the last one. the returned observation is valid until the next
+   step, terminal is set when any terminal predicate matches after the last frame.
+   with grayscale or packed observations the framebuffer of the last frame holds shade indices instead of rgb565.
+   a watchpoint with stop set ends the step right after the cycle of the hit: stopped is set, terminal is checked at
+   that point and the previous observation is returned. the next step finishes the interrupted frame as its first one */
+BBOY_API const uint8_t* bboy_step(bboy_gameboy* gameboy, uint8_t buttons, uint32_t repeat, size_t* size, int* terminal,
+                                  int* stopped);
+/* downsample must divide both lcd sizes, each observation pixel averages a downsample * downsample block. 0 on success */
+BBOY_API int bboy_set_observation(bboy_gameboy* gameboy, int format, uint32_t downsample); /* bboy_observation */
+/* 0 on success, -1 for an unknown compare */
+BBOY_API int bboy_add_terminal(bboy_gameboy* gameboy, uint16_t address, uint8_t mask, int compare, uint8_t value);
+BBOY_API void bboy_clear_terminals(bboy_gameboy* gameboy);
+
+/* cpu accesses to first..last call the watch callback, only pages holding a watchpoint are slowed down. a bank >= 0
+   limits rom and external ram ranges to that bank. with stop set the step returns after the cycle of the hit.
+   returns the id for bboy_remove_watchpoint */
+BBOY_API uint32_t bboy_add_watchpoint(bboy_gameboy* gameboy, uint16_t first, uint16_t last, int access, int bank,
+                                      int stop); /* bboy_watch flags */
+BBOY_API void bboy_remove_watchpoint(bboy_gameboy* gameboy, uint32_t id);
+BBOY_API void bboy_clear_watchpoints(bboy_gameboy* gameboy);
+BBOY_API void bboy_set_watch_callback(bboy_gameboy* gameboy, bboy_watch_callback callback, void* user);
+
+/* game genie (ABC-DEF, ABC-DEF-GHI) or gameshark (TTVVLLHH) codes, 0 on success. game genie codes patch the rom banks
+   they apply to, gameshark codes write external ram, wram or hram at the end of every frame. both are kept across
+   rom loads */
+BBOY_API int bboy_add_cheat(bboy_gameboy* gameboy, const char* code);
+BBOY_API void bboy_clear_cheats(bboy_gameboy* gameboy);
+
+/* BBOY_LCD_WIDTH * BBOY_LCD_HEIGHT rgb565 pixels, row major */
+BBOY_API const uint16_t* bboy_framebuffer(const bboy_gameboy* gameboy);
+BBOY_API uint8_t* bboy_vram(bboy_gameboy* gameboy, size_t* size);
+BBOY_API uint8_t* bboy_wram(bboy_gameboy* gameboy, size_t* size);
+BBOY_API uint8_t* bboy_oam(bboy_gameboy* gameboy, size_t* size);
+BBOY_API uint8_t* bboy_hram(bboy_gameboy* gameboy, size_t* size);
+
+/* bboy_save_state returns the state size or 0 on failure, nothing is written if buffer is null or too small */
+BBOY_API size_t bboy_save_state(bboy_gameboy* gameboy, uint8_t* buffer, size_t size);
+BBOY_API int bboy_load_state(bboy_gameboy* gameboy, const uint8_t* data, size_t size); /* 0 on success */
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -6,8 +6,9 @@
 Config::Config()
   : m_volume{}
   , m_palette{}
+  , m_accuracy{Accuracy::accurate}
 {
-  const std::string defaultConfig{"volume=" + std::to_string(0.3f) + "\npalette=green"};
+  const std::string defaultConfig{"volume=" + std::to_string(0.3f) + "\npalette=green\naccuracy=accurate"};
   namespace fs = std::filesystem;
   if(!fs::exists(fileName))
   {
@@ -30,6 +31,7 @@ Config::Config()
   configFile.close();
 
   std::string volume{};
+  std::string accuracy{};
   int tokenParsed{};
   bool tokenFound{};
   for(auto c : config)
@@ -44,6 +46,7 @@ Config::Config()
       }
       if(tokenParsed == 0) volume.push_back(c);
       else if(tokenParsed == 1) m_palette.push_back(c);
+      else if(tokenParsed == 2) accuracy.push_back(c);
     }
     else if(c == '=') tokenFound = true;
   }
@@ -59,6 +62,9 @@ Config::Config()
   }
 
   if(m_volume > 1.f) m_volume = 1.f;
+
+  if(accuracy == "fast") m_accuracy = Accuracy::fast;
+  else if(!accuracy.empty() && accuracy != "accurate") std::cerr << "accuracy not valid, fallback to default" << '\n';
 }
 
 float Config::getVolume() const
@@ -70,3 +76,8 @@ std::string_view Config::getPalette() const
 {
   return m_palette;
 }
+
+Accuracy Config::getAccuracy() const
+{
+  return m_accuracy;
+}
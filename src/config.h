@@ -1,4 +1,5 @@
 #pragma once
+#include "core/accuracy.h"
 #include <string>
 
 class Config
@@ -12,6 +13,7 @@ public:
 
   float getVolume() const;
   std::string_view getPalette() const;
+  Accuracy getAccuracy() const;
 
 private:
   Config();
@@ -22,4 +24,5 @@ private:
 
   float m_volume;
   std::string m_palette;
+  Accuracy m_accuracy;
 };
@@ -0,0 +1,16 @@
+#pragma once
+
+//compile time accuracy profiles, the hot paths are instantiated once per profile and picked when a rom is loaded
+enum class Accuracy
+{
+  accurate,
+  fast,
+};
+
+template<Accuracy profile>
+struct AccuracyProfile
+{
+  static constexpr bool busBlocking{profile == Accuracy::accurate};      //dma and ppu modes lock the cpu out of memory
+  static constexpr bool pixelFifo{profile == Accuracy::accurate};        //dot based fifo instead of whole scanlines
+  static constexpr bool lcdReEnableDelay{profile == Accuracy::accurate}; //first line after turning the lcd on
+};
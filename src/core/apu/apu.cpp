@@ -1,18 +1,21 @@
 #include "core/apu/apu.h"
 #include "core/mmu.h"
+#include "core/save_state.h"
 #include <SDL3/SDL_audio.h>
 //#include <iostream>
 
-APU::APU(MMU& mmu, float volume)
+APU::APU(MMU& mmu, float volume, bool output)
   : m_bus(mmu)
-  , m_audioThread{*this}
+  , m_audioThread{*this, output}
   , m_audioStream{}
   , m_samplesBuffer{}
   , m_outSamples{}
   , m_frameSequencerCounter{}
   , m_frameSequencerStep{}
-  , m_nextCycleToExecute{}
+  , m_cycle{}
+  , m_frameEndCycle{}
   , m_volume{volume}
+  , m_deterministic{}
   , m_channel1{}
   , m_channel2{}
   , m_channel3{}
@@ -21,26 +24,30 @@ APU::APU(MMU& mmu, float volume)
   , m_audioPanning{}
   , m_audioControl{}
 {
-  SDL_AudioSpec spec{SDL_AudioFormat::SDL_AUDIO_F32, 2, frequency};
-  m_audioStream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, nullptr, nullptr);
-  SDL_ResumeAudioStreamDevice(m_audioStream);
+  if(output)
+  {
+    SDL_AudioSpec spec{SDL_AudioFormat::SDL_AUDIO_F32, 2, frequency};
+    m_audioStream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, nullptr, nullptr);
+    SDL_ResumeAudioStreamDevice(m_audioStream);
+  }
   reset();
 }
 
 APU::~APU()
 {
   m_audioThread.shutdown();
-  SDL_DestroyAudioStream(m_audioStream);
+  if(m_audioStream) SDL_DestroyAudioStream(m_audioStream);
 }
 
 void APU::reset()
 {
   m_audioThread.waitToFinish();
-  SDL_ClearAudioStream(m_audioStream);
+  if(m_audioStream) SDL_ClearAudioStream(m_audioStream);
   m_samplesBuffer.clear();
   m_outSamples.clear();
   m_frameSequencerCounter = 0;
-  m_nextCycleToExecute = 1;
+  m_cycle = 0; //the master clock restarts with every reset
+  m_frameEndCycle = 0;
   m_channel1 = channels::SweepPulseChannel{};
   m_channel2 = channels::PulseChannel{};
   m_channel3 = channels::WaveChannel{};
@@ -52,9 +59,17 @@ void APU::reset()
 
 void APU::unlockThread()
 {
+  m_audioThread.waitToFinish();
+  m_frameEndCycle = m_bus.currentCycle();
   m_audioThread.unlock();
 }
 
+void APU::setDeterministic(const bool deterministic)
+{
+  m_audioThread.waitToFinish();
+  m_deterministic = deterministic;
+}
+
 uint8 APU::read(const Index index, uint8 waveRamIndex)
 {
   if(index == ch1PeLow || index == ch2PeLow || index == ch3Tim || index == ch3PeLow || index == ch4Tim) return 0xFF;
@@ -129,6 +144,37 @@ void APU::write(const Index index, const uint8 value, uint8 waveRamIndex)
   }
 }
 
+void APU::saveState(StateWriter& state)
+{
+  m_audioThread.waitToFinish();
+  state.write(m_frameSequencerCounter);
+  state.write(m_frameSequencerStep);
+  state.write(m_cycle);
+  m_channel1.saveState(state);
+  m_channel2.saveState(state);
+  m_channel3.saveState(state);
+  m_channel4.saveState(state);
+  state.write(m_audioVolume);
+  state.write(m_audioPanning);
+  state.write(m_audioControl);
+}
+
+void APU::loadState(StateReader& state)
+{
+  m_audioThread.waitToFinish();
+  m_samplesBuffer.clear();
+  state.read(m_frameSequencerCounter);
+  state.read(m_frameSequencerStep);
+  state.read(m_cycle);
+  m_channel1.loadState(state);
+  m_channel2.loadState(state);
+  m_channel3.loadState(state);
+  m_channel4.loadState(state);
+  state.read(m_audioVolume);
+  state.read(m_audioPanning);
+  state.read(m_audioControl);
+}
+
 void APU::clearRegisters()
 {
   m_channel1.clearRegisters();
@@ -176,6 +222,7 @@ void APU::mCycle()
   m_channel3.pushCycle();
   m_channel3.pushCycle();
   m_channel4.pushCycle();
+  if(!m_audioStream) return; //nothing to mix into
 
   static constexpr auto digitalToAnalog{[]
                                         {
@@ -240,24 +287,26 @@ void APU::mCycle()
 void APU::catchUp()
 {
   m_audioThread.waitToFinish();
-  for(int i{m_nextCycleToExecute}; i <= m_bus.currentCycle(); ++i) mCycle();
-  m_nextCycleToExecute = m_bus.currentCycle() + 1;
+  for(const uint64_t cycle{m_bus.currentCycle()}; m_cycle < cycle; ++m_cycle) mCycle();
 }
 
 void APU::finishFrame()
 {
-  for(int i{m_nextCycleToExecute}; i <= mCyclesPerFrame; ++i) mCycle();
-  m_nextCycleToExecute = 1;
+  for(; m_cycle < m_frameEndCycle; ++m_cycle) mCycle();
   pushAudio();
 }
 
 void APU::pushAudio()
 {
+  if(!m_audioStream) return;
+
   constexpr int target{static_cast<int>(((mCyclesPerFrame * 59.7) / frequency))};
   int samplesQueued{SDL_GetAudioStreamQueued(m_audioStream)};
-  int adjustedTarget{target + static_cast<int>(samplesQueued > frequency / 4)};
+  //catching up on a backed up queue by dropping samples would make the output depend on the host
+  int adjustedTarget{target + static_cast<int>(!m_deterministic && samplesQueued > frequency / 4)};
   int counter{};
-  for(size_t i{1}; i < mCyclesPerFrame; ++i)
+  //frames end on vblank so their length varies, and nothing gets mixed while the apu is off
+  for(size_t i{1}; i < m_samplesBuffer.size() / 2; ++i)
   {
     if(i % adjustedTarget == 0)
     {
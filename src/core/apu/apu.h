@@ -7,11 +7,13 @@
 #include <vector>
 
 class MMU;
+class StateWriter;
+class StateReader;
 struct SDL_AudioStream;
 class APU
 {
 public:
-  APU(MMU& bus, float volume = 0.3f);
+  APU(MMU& bus, float volume = 0.3f, bool output = true); //without output samples are not mixed nor queued
   ~APU();
 
   enum Index
@@ -42,9 +44,13 @@ public:
 
   void reset();
   void unlockThread();
+  void setDeterministic(const bool deterministic); //queued samples don't depend on the host audio queue
   uint8 read(const Index index, const uint8 waveRamIndex = 0);
   void write(const Index index, const uint8 value, const uint8 waveRamIndex = 0);
 
+  void saveState(StateWriter& state); //not const because it waits for the audio thread to finish the last frame
+  void loadState(StateReader& state);
+
 private:
   friend class AudioThread;
 
@@ -66,8 +72,10 @@ private:
   std::vector<float> m_outSamples;
   uint16 m_frameSequencerCounter;
   uint8 m_frameSequencerStep;
-  uint16 m_nextCycleToExecute;
+  uint64_t m_cycle;         //last master clock cycle the channels were stepped to
+  uint64_t m_frameEndCycle; //master clock at the end of the frame the audio thread is finishing
   float m_volume;
+  bool m_deterministic;
 
   channels::SweepPulseChannel m_channel1;
   channels::PulseChannel m_channel2;
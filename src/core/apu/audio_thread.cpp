@@ -1,19 +1,28 @@
 #include "core/apu/audio_thread.h"
 #include "core/apu/apu.h"
 
-AudioThread::AudioThread(APU& apu)
+AudioThread::AudioThread(APU& apu, bool threaded)
   : m_apu{apu}
-  , m_thread{&AudioThread::threadLoop, this}
+  , m_thread{}
   , m_mutex{}
   , m_condition{}
   , m_executing{}
   , m_shutdown{}
+  , m_threaded{threaded}
 {
+  if(!m_threaded) return;
+  m_thread = std::thread{&AudioThread::threadLoop, this};
   m_thread.detach();
 }
 
 void AudioThread::unlock()
 {
+  if(!m_threaded)
+  {
+    m_apu.finishFrame();
+    return;
+  }
+
   std::unique_lock<std::mutex> lock(m_mutex);
   m_condition.wait(lock, [this] { return !m_executing; });
   m_executing = true;
@@ -22,12 +31,14 @@ void AudioThread::unlock()
 
 void AudioThread::waitToFinish()
 {
+  if(!m_threaded) return;
   std::unique_lock<std::mutex> lock(m_mutex);
   m_condition.wait(lock, [this] { return !m_executing; });
 }
 
 void AudioThread::shutdown()
 {
+  if(!m_threaded) return;
   waitToFinish();
   m_shutdown = true;
   m_condition.notify_one();
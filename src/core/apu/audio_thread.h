@@ -7,7 +7,7 @@ class APU;
 class AudioThread
 {
 public:
-  AudioThread(APU& apu);
+  AudioThread(APU& apu, bool threaded = true); //when not threaded the frame is finished inline on unlock()
 
   void unlock();
   void waitToFinish();
@@ -22,4 +22,5 @@ private:
   std::condition_variable m_condition;
   std::atomic<bool> m_executing;
   bool m_shutdown;
+  bool m_threaded;
 };
@@ -1,4 +1,5 @@
 #include "core/apu/envelope.h"
+#include "core/save_state.h"
 
 channels::Envelope::Envelope()
   : m_volumeAndEnvelope{}
@@ -53,3 +54,21 @@ void channels::Envelope::trigger()
   constexpr uint8 dirBit{0x8};
   m_dir = static_cast<bool>(m_volumeAndEnvelope & dirBit);
 }
+
+void channels::Envelope::saveState(StateWriter& state) const
+{
+  state.write(m_volumeAndEnvelope);
+  state.write(m_volume);
+  state.write(m_target);
+  state.write(m_timer);
+  state.write(m_dir);
+}
+
+void channels::Envelope::loadState(StateReader& state)
+{
+  state.read(m_volumeAndEnvelope);
+  state.read(m_volume);
+  state.read(m_target);
+  state.read(m_timer);
+  state.read(m_dir);
+}
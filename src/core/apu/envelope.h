@@ -1,6 +1,9 @@
 #pragma once
 #include "type_alias.h"
 
+class StateWriter;
+class StateReader;
+
 namespace channels
 {
 class Envelope
@@ -17,6 +20,9 @@ public:
   bool dac() const;
   void trigger();
 
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
 private:
   static constexpr uint8 targetBits{0x7};
 
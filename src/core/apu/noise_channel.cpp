@@ -1,4 +1,5 @@
 #include "core/apu/noise_channel.h"
+#include "core/save_state.h"
 #include <array>
 
 channels::NoiseChannel::NoiseChannel()
@@ -126,3 +127,29 @@ void channels::NoiseChannel::trigger()
   constexpr uint8 volumeBits{0xF0};
   m_envelope.trigger();
 }
+
+void channels::NoiseChannel::saveState(StateWriter& state) const
+{
+  state.write(m_timer);
+  state.write(m_frequencyAndRandomness);
+  state.write(m_control);
+  state.write(m_enabled);
+  state.write(m_lfsr);
+  state.write(m_sample);
+  state.write(m_pushTimer);
+  state.write(m_disableTimer);
+  m_envelope.saveState(state);
+}
+
+void channels::NoiseChannel::loadState(StateReader& state)
+{
+  state.read(m_timer);
+  state.read(m_frequencyAndRandomness);
+  state.read(m_control);
+  state.read(m_enabled);
+  state.read(m_lfsr);
+  state.read(m_sample);
+  state.read(m_pushTimer);
+  state.read(m_disableTimer);
+  m_envelope.loadState(state);
+}
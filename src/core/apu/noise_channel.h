@@ -2,6 +2,9 @@
 #include "core/apu/envelope.h"
 #include "type_alias.h"
 
+class StateWriter;
+class StateReader;
+
 namespace channels
 {
 class NoiseChannel
@@ -26,6 +29,9 @@ public:
   void setFrequencyAndRandomness(const uint8 value);
   void setControl(const uint8 value);
 
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
 private:
   void setPushTimer();
   void trigger();
@@ -1,4 +1,5 @@
 #include "core/apu/pulse_channels.h"
+#include "core/save_state.h"
 
 channels::PulseChannelBase::PulseChannelBase()
   : m_timerAndDuty{}
@@ -199,3 +200,45 @@ void channels::SweepPulseChannel::sweepIteration()
   }
   else disable();
 }
+
+void channels::PulseChannelBase::saveState(StateWriter& state) const
+{
+  state.write(m_timerAndDuty);
+  state.write(m_periodLow);
+  state.write(m_periodHighAndControl);
+  state.write(m_enabled);
+  state.write(m_sample);
+  state.write(m_pushTimer);
+  state.write(m_disableTimer);
+  state.write(m_dutyStep);
+  m_envelope.saveState(state);
+}
+
+void channels::PulseChannelBase::loadState(StateReader& state)
+{
+  state.read(m_timerAndDuty);
+  state.read(m_periodLow);
+  state.read(m_periodHighAndControl);
+  state.read(m_enabled);
+  state.read(m_sample);
+  state.read(m_pushTimer);
+  state.read(m_disableTimer);
+  state.read(m_dutyStep);
+  m_envelope.loadState(state);
+}
+
+void channels::SweepPulseChannel::saveState(StateWriter& state) const
+{
+  PulseChannelBase::saveState(state);
+  state.write(m_sweep);
+  state.write(m_shadowPeriod);
+  state.write(m_sweepTimer);
+}
+
+void channels::SweepPulseChannel::loadState(StateReader& state)
+{
+  PulseChannelBase::loadState(state);
+  state.read(m_sweep);
+  state.read(m_shadowPeriod);
+  state.read(m_sweepTimer);
+}
@@ -3,6 +3,9 @@
 #include "type_alias.h"
 #include <array>
 
+class StateWriter;
+class StateReader;
+
 namespace channels
 {
 class PulseChannelBase
@@ -25,6 +28,9 @@ public:
   void setPeriodLow(const uint8 value);
   void setPeriodHighAndControl(const uint8 value);
 
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
 protected:
   PulseChannelBase();
 
@@ -74,6 +80,9 @@ public:
   uint8 getSweep() const;
   void setSweep(uint8 value);
 
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
 private:
   void trigger() override;
   void sweepIteration();
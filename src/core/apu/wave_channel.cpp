@@ -1,4 +1,5 @@
 #include "core/apu/wave_channel.h"
+#include "core/save_state.h"
 
 channels::WaveChannel::WaveChannel()
   : m_dacEnable{}
@@ -133,3 +134,33 @@ void channels::WaveChannel::setPushTimer()
   m_pushTimer = ((maxPeriod + 1) - (m_periodLow | ((m_periodHighAndControl & periodHighBits)
                                                    << 8))) /*this should be multiplied by 2 but it sounds better like this*/;
 }
+
+void channels::WaveChannel::saveState(StateWriter& state) const
+{
+  state.write(m_dacEnable);
+  state.write(m_timer);
+  state.write(m_outLevel);
+  state.write(m_periodLow);
+  state.write(m_periodHighAndControl);
+  state.write(m_waveRam);
+  state.write(m_enabled);
+  state.write(m_pushTimer);
+  state.write(m_sample);
+  state.write(m_waveIndex);
+  state.write(m_disableTimer);
+}
+
+void channels::WaveChannel::loadState(StateReader& state)
+{
+  state.read(m_dacEnable);
+  state.read(m_timer);
+  state.read(m_outLevel);
+  state.read(m_periodLow);
+  state.read(m_periodHighAndControl);
+  state.read(m_waveRam);
+  state.read(m_enabled);
+  state.read(m_pushTimer);
+  state.read(m_sample);
+  state.read(m_waveIndex);
+  state.read(m_disableTimer);
+}
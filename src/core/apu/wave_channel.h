@@ -2,6 +2,9 @@
 #include "type_alias.h"
 #include <array>
 
+class StateWriter;
+class StateReader;
+
 namespace channels
 {
 class WaveChannel
@@ -28,6 +31,9 @@ public:
   void setPeriodHighAndControl(const uint8 value);
   void setWaveRam(const uint8 value, uint8 index);
 
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
 private:
   void trigger();
   void setPushTimer();
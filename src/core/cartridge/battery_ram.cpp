@@ -0,0 +1,259 @@
+#include "core/cartridge/battery_ram.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+//a single thread writes the saves of every instance, flushes are rare and short
+class Flusher
+{
+public:
+  static Flusher& get()
+  {
+    static Flusher flusher;
+    return flusher;
+  }
+
+  void post(const std::filesystem::path& path, std::function<void()> write)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_jobs.push_back({path, std::move(write)});
+    }
+    m_wake.notify_one();
+  }
+
+  //until no job for path is queued or running, jobs of other saves don't hold anyone up
+  void waitFor(const std::filesystem::path& path)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto samePath{[&path](const Job& job) { return job.path == path; }};
+    m_idle.wait(lock, [&] { return m_current != path && std::none_of(m_jobs.begin(), m_jobs.end(), samePath); });
+  }
+
+private:
+  struct Job
+  {
+    std::filesystem::path path;
+    std::function<void()> write;
+  };
+
+  Flusher()
+    : m_current{}
+    , m_stop{}
+    , m_thread{[this] { loop(); }}
+  {
+  }
+
+  ~Flusher()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+  }
+
+  void loop()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+      m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+      if(m_jobs.empty()) return; //only stops once everything queued is written
+      Job job{std::move(m_jobs.front())};
+      m_jobs.pop_front();
+      m_current = job.path;
+      lock.unlock();
+      job.write();
+      job.write = nullptr; //can hold the last reference to a save file, which unmaps and unlocks it
+      lock.lock();
+      m_current.clear();
+      m_idle.notify_all();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_idle;
+  std::deque<Job> m_jobs;
+  std::filesystem::path m_current; //of the running job, empty while idle
+  bool m_stop;
+  std::thread m_thread; //last, it starts running in the constructor
+};
+
+void loadFile(const std::filesystem::path& path, uint8* data, const size_t size)
+{
+  std::ifstream save(path, std::ios::binary);
+  if(save.fail())
+  {
+    std::cout << "No save file found or couldn't open it\n";
+    return;
+  }
+  save.read(reinterpret_cast<char*>(data), size); //a shorter file leaves the rest cleared
+}
+} //namespace
+
+struct BatteryRam::SaveFile
+{
+  ~SaveFile();
+  void write(); //on the flusher thread
+
+  std::filesystem::path path;
+  size_t size{};
+  int fd{-1};
+  void* mapping{}; //null when the ram is a buffer
+  std::mutex mutex;
+  std::vector<uint8> pending; //copy of a buffer ram waiting to be written, empty once it is
+};
+
+BatteryRam::SaveFile::~SaveFile()
+{
+#ifndef _WIN32
+  if(mapping) munmap(mapping, size);
+  if(fd >= 0) close(fd); //drops the lock
+#endif
+}
+
+void BatteryRam::SaveFile::write()
+{
+#ifndef _WIN32
+  if(mapping)
+  {
+    if(msync(mapping, size, MS_SYNC) != 0) std::cerr << "Couldn't sync save file " << path << '\n';
+    return;
+  }
+#endif
+  std::vector<uint8> bytes{};
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes.swap(pending);
+  }
+  if(bytes.empty()) return; //a later job got here first
+
+  //whatever follows the ram and the footer in the old file is carried over
+  std::vector<uint8> tail{};
+  if(std::ifstream old{path, std::ios::binary | std::ios::ate}; !old.fail())
+  {
+    const std::streamoff oldSize{old.tellg()};
+    if(oldSize > static_cast<std::streamoff>(bytes.size()))
+    {
+      tail.resize(static_cast<size_t>(oldSize) - bytes.size());
+      old.seekg(static_cast<std::streamoff>(bytes.size()));
+      old.read(reinterpret_cast<char*>(tail.data()), static_cast<std::streamsize>(tail.size()));
+    }
+  }
+
+  std::filesystem::path temporary{path};
+  temporary += ".tmp";
+  {
+    std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.write(reinterpret_cast<const char*>(tail.data()), static_cast<std::streamsize>(tail.size()));
+    file.close();
+    if(file.fail())
+    {
+      std::cerr << "Couldn't write save file " << temporary << '\n';
+      return;
+    }
+  }
+  std::error_code error{};
+  std::filesystem::rename(temporary, path, error);
+  if(error) std::cerr << "Couldn't replace save file " << path << ": " << error.message() << '\n';
+}
+
+BatteryRam::BatteryRam()
+  : m_file{}
+  , m_buffer{}
+  , m_data{}
+  , m_size{}
+  , m_footerSize{}
+  , m_cycles{}
+  , m_dirty{}
+{
+}
+
+BatteryRam::~BatteryRam()
+{
+  if(m_dirty) flush();
+}
+
+void BatteryRam::open(const size_t size, const size_t footerSize, const std::filesystem::path& savePath)
+{
+  const size_t fileSize{size + footerSize};
+  m_file.reset();
+  m_buffer.assign(fileSize, 0);
+  m_data = m_buffer.data();
+  m_size = size;
+  m_footerSize = footerSize;
+  m_cycles = 0;
+  m_dirty = false;
+  if(savePath.empty() || fileSize == 0) return;
+
+  //the last flush of a cartridge with the same save can still be queued and hold the file lock
+  Flusher::get().waitFor(savePath);
+  std::shared_ptr<SaveFile> file{std::make_shared<SaveFile>()};
+  file->path = savePath;
+  file->size = fileSize;
+
+#ifndef _WIN32
+  file->fd = ::open(savePath.c_str(), O_RDWR | O_CREAT, 0644);
+  if(file->fd >= 0 && flock(file->fd, LOCK_EX | LOCK_NB) != 0)
+  {
+    std::cerr << "Save file " << savePath << " is used by another instance, this one won't be saved\n";
+    loadFile(savePath, m_data, fileSize);
+    return;
+  }
+  struct stat status{};
+  if(file->fd >= 0 && fstat(file->fd, &status) == 0 &&
+     (static_cast<size_t>(status.st_size) >= fileSize || ftruncate(file->fd, static_cast<off_t>(fileSize)) == 0))
+  {
+    void* mapping{mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0)};
+    if(mapping != MAP_FAILED)
+    {
+      file->mapping = mapping;
+      m_data = static_cast<uint8*>(mapping);
+      m_buffer = {};
+      m_file = std::move(file);
+      return;
+    }
+  }
+  std::cerr << "Couldn't map save file " << savePath << ", saving through a copy instead\n";
+  //the lock stays held through fd, the copy is renamed over the file
+#endif
+  loadFile(savePath, m_data, fileSize);
+  m_file = std::move(file);
+}
+
+void BatteryRam::clock(const uint32 mCycles)
+{
+  m_cycles = std::min(m_cycles + mCycles, flushInterval);
+  if(m_dirty && m_cycles == flushInterval) flush();
+}
+
+void BatteryRam::flush()
+{
+  m_dirty = false;
+  m_cycles = 0;
+  if(!m_file) return;
+  if(!m_file->mapping)
+  {
+    std::lock_guard<std::mutex> lock(m_file->mutex);
+    m_file->pending.assign(m_data, m_data + m_size + m_footerSize);
+  }
+  Flusher::get().post(m_file->path, [file{m_file}] { file->write(); });
+}
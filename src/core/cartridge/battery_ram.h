@@ -0,0 +1,49 @@
+#pragma once
+#include "type_alias.h"
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+//external cartridge ram. without a save path it's plain memory, with one the bytes end up in the .sav file without the
+//emulation thread ever waiting on io:
+//on posix the ram is a shared mapping of the file, so every write is in the page cache right away and survives the
+//process crashing. a background flusher msyncs it at a bounded interval while it's dirty.
+//elsewhere, or when the file can't be mapped, a dirty ram is copied once per interval and the flusher writes the copy
+//to a temporary file that is renamed over the .sav, so the file is always either the old or the new save
+class BatteryRam
+{
+public:
+  BatteryRam();
+  ~BatteryRam(); //queues the last flush
+  BatteryRam(const BatteryRam&) = delete;
+  BatteryRam& operator=(const BatteryRam&) = delete;
+
+  //size bytes of ram followed by footerSize bytes the cartridge stores along with it, loaded from savePath if it exists.
+  //the file is extended if it's shorter, bytes past the footer are kept as they are
+  void open(const size_t size, const size_t footerSize, const std::filesystem::path& savePath);
+
+  uint8* data() { return m_data; }
+  const uint8* data() const { return m_data; }
+  size_t size() const { return m_size; } //of the ram alone
+  bool empty() const { return m_size == 0; }
+  uint8* footer() { return m_data + m_size; }
+
+  bool hasSaveFile() const { return m_file != nullptr; }
+  //every write to a ram with a save file goes through the cartridge's writeRam, which marks it
+  void markDirty() { m_dirty = true; }
+  void clock(const uint32 mCycles); //flushes if dirty once the interval has passed
+
+  static constexpr uint32 flushInterval{1 << 20}; //m-cycles, about a second
+
+private:
+  struct SaveFile; //shared with the flusher, which may still be writing it after the ram is gone
+  void flush();
+
+  std::shared_ptr<SaveFile> m_file; //null without a save path
+  std::vector<uint8> m_buffer;      //the bytes unless they're mapped
+  uint8* m_data;
+  size_t m_size;
+  size_t m_footerSize;
+  uint32 m_cycles; //since the last flush
+  bool m_dirty;
+};
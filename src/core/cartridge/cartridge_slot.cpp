@@ -1,13 +1,16 @@
 #include "core/cartridge/cartridge_slot.h"
-#include "core/cartridge/cartridges.h"
+#include "core/cartridge/rom_archive.h"
+#include "core/save_state.h"
 #include <fstream>
 #include <iostream>
 
 CartridgeSlot::CartridgeSlot()
   : m_cartridge{}
   , m_cartridgePath{}
-  , m_cartridgeHasClock{}
-  , m_frameCounter{}
+  , m_patchPath{}
+  , m_batterySaves{true}
+  , m_rtcClock{}
+  , m_romCheats{}
 {
   reset();
 }
@@ -19,42 +22,71 @@ CartridgeSlot::~CartridgeSlot()
 
 void CartridgeSlot::reset()
 {
-  if(m_cartridge) m_cartridge->save(m_cartridgePath);
-  delete m_cartridge;
-  m_cartridge = nullptr;
-  m_cartridgeHasClock = false;
+  m_cartridge.emplace<std::monostate>();
 }
 
-void CartridgeSlot::loadCartridge(const std::filesystem::path& path)
+void CartridgeSlot::loadCartridge(const std::filesystem::path& path, const std::filesystem::path& patchPath)
 {
-  if(m_cartridge) reset();
-  if(path.extension() != ".gb")
+  if(hasCartridge()) reset();
+  if(!isRomFile(path))
   {
     std::cerr << "Invalid file extension " << path.extension() << '\n';
     return;
   }
+  const std::filesystem::path romPath{RomArchive::detect(path) == RomArchive::Format::none
+                                        ? path
+                                        : path.parent_path() / path.stem()};
 
-  std::ifstream rom(path, std::ios::binary);
-  if(rom.fail())
+  std::filesystem::path patch{patchPath};
+  for(const char* extension : {".ips", ".bps"})
   {
-    std::cerr << "failed to open file";
+    std::filesystem::path candidate{romPath};
+    std::error_code error{};
+    if(patch.empty() && std::filesystem::exists(candidate.replace_extension(extension), error)) patch = candidate;
+  }
+
+  std::shared_ptr<const RomImage> rom{RomImage::load(path, patch)};
+  if(!rom) return;
+
+  insertCartridge(std::move(rom), m_batterySaves ? romPath : std::filesystem::path{});
+  m_cartridgePath = path;
+  m_patchPath = patchPath; //a reload looks for a patch next to the rom again
+  m_cartridgeName = romPath.filename().stem();
+}
+
+void CartridgeSlot::loadCartridge(std::shared_ptr<const RomImage> rom, const std::string& name)
+{
+  if(hasCartridge()) reset();
+  if(!rom) return;
+
+  insertCartridge(std::move(rom), {});
+  m_cartridgePath.clear();
+  m_patchPath.clear();
+  m_cartridgeName = name;
+}
+
+void CartridgeSlot::insertCartridge(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path)
+{
+  //whatever the file is called, dmg compatible color roms run and color only ones are refused
+  constexpr uint16 cgbFlagAddress{0x143};
+  constexpr uint8 cgbOnly{0xC0};
+  if(rom->data()[cgbFlagAddress] == cgbOnly)
+  {
+    std::cerr << "Rom only runs on a Game Boy Color\n";
     return;
   }
 
   constexpr uint16 mbcHeaderAddress{0x147};
-  rom.seekg(mbcHeaderAddress, std::ios::beg);
-  uint8 mbcValue{};
-  rom.read(reinterpret_cast<char*>(&mbcValue), 1);
-  rom.close();
+  const uint8 mbcValue{rom->data()[mbcHeaderAddress]};
 
   switch(mbcValue)
   {
   case 0x00:
   case 0x08:
-  case 0x09: m_cartridge = new Cartridge(path); break;
-  case 0x01: m_cartridge = new CartridgeMbc1(path); break;
-  case 0x02: m_cartridge = new CartridgeMbc1(path, true); break;
-  case 0x03: m_cartridge = new CartridgeMbc1(path, true, true); break;
+  case 0x09: m_cartridge.emplace<Cartridge>(rom, path); break;
+  case 0x01: m_cartridge.emplace<CartridgeMbc1>(rom, path); break;
+  case 0x02: m_cartridge.emplace<CartridgeMbc1>(rom, path, true); break;
+  case 0x03: m_cartridge.emplace<CartridgeMbc1>(rom, path, true, true); break;
   /*case 0x05:
           //m_cartridgeInfo.mbc = MbcType::mbc2;
           break;
@@ -63,32 +95,32 @@ void CartridgeSlot::loadCartridge(const std::filesystem::path& path)
           //m_cartridgeInfo.hasRam = true;
           //m_cartridgeInfo.hasBattery = true;
           break;*/
-  case 0x0f:
-    m_cartridge = new CartridgeMbc3(path, false, false, true);
-    m_cartridgeHasClock = true;
-    break;
-  case 0x10:
-    m_cartridge = new CartridgeMbc3(path, true, true, true);
-    m_cartridgeHasClock = true;
-    break;
-  case 0x11: m_cartridge = new CartridgeMbc3(path); break;
-  case 0x12: m_cartridge = new CartridgeMbc3(path, true); break;
-  case 0x13: m_cartridge = new CartridgeMbc3(path, true, true); break;
-  case 0x19: m_cartridge = new CartridgeMbc5(path); break;
-  case 0x1A: m_cartridge = new CartridgeMbc5(path, true); break;
-  case 0x1B: m_cartridge = new CartridgeMbc5(path, true, true); break;
-  case 0x1C: m_cartridge = new CartridgeMbc5(path, false, false, true); break;
-  case 0x1D: m_cartridge = new CartridgeMbc5(path, true, false, true); break;
-  case 0x1E: m_cartridge = new CartridgeMbc5(path, true, true, true); break;
+  case 0x0f: m_cartridge.emplace<CartridgeMbc3>(rom, path, false, true, true, m_rtcClock); break;
+  case 0x10: m_cartridge.emplace<CartridgeMbc3>(rom, path, true, true, true, m_rtcClock); break;
+  case 0x11: m_cartridge.emplace<CartridgeMbc3>(rom, path); break;
+  case 0x12: m_cartridge.emplace<CartridgeMbc3>(rom, path, true); break;
+  case 0x13: m_cartridge.emplace<CartridgeMbc3>(rom, path, true, true); break;
+  case 0x19: m_cartridge.emplace<CartridgeMbc5>(rom, path); break;
+  case 0x1A: m_cartridge.emplace<CartridgeMbc5>(rom, path, true); break;
+  case 0x1B: m_cartridge.emplace<CartridgeMbc5>(rom, path, true, true); break;
+  case 0x1C: m_cartridge.emplace<CartridgeMbc5>(rom, path, false, false, true); break;
+  case 0x1D: m_cartridge.emplace<CartridgeMbc5>(rom, path, true, false, true); break;
+  case 0x1E: m_cartridge.emplace<CartridgeMbc5>(rom, path, true, true, true); break;
+  default:    std::cerr << "Unsupported cartridge type 0x" << std::hex << static_cast<int>(mbcValue) << std::dec << '\n'; break;
   }
-
-  m_cartridgePath = path;
-  m_cartridgeName = path.filename().stem();
+  if(!m_romCheats.empty()) visit(m_cartridge, [this](auto& cartridge) { cartridge.setRomCheats(m_romCheats); });
 }
 
 void CartridgeSlot::reloadCartridge()
 {
-  loadCartridge(m_cartridgePath);
+  if(m_cartridgePath.empty())
+  {
+    if(!hasCartridge()) return;
+    std::shared_ptr<const RomImage> rom{
+      visit(m_cartridge, [](const auto& cartridge) { return cartridge.getRomImage(); })};
+    loadCartridge(std::move(rom), m_cartridgeName);
+  }
+  else loadCartridge(m_cartridgePath, m_patchPath);
 }
 
 const std::string& CartridgeSlot::getCartridgeName() const
@@ -98,38 +130,73 @@ const std::string& CartridgeSlot::getCartridgeName() const
 
 bool CartridgeSlot::hasCartridge() const
 {
-  return static_cast<bool>(m_cartridge);
+  return !std::holds_alternative<std::monostate>(m_cartridge);
 }
 
-void CartridgeSlot::clockFrame()
+bool CartridgeSlot::isRomFile(const std::filesystem::path& path)
 {
-  if(m_cartridgeHasClock)
+  if(RomArchive::detect(path) != RomArchive::Format::none) return true;
+  return path.extension() == ".gb" || path.extension() == ".gbc";
+}
+
+bool CartridgeSlot::isSupported(const uint8 cartridgeType)
+{
+  switch(cartridgeType) //the types insertCartridge knows
   {
-    constexpr int oneSecondFrames{60}; //circa
-    if(++m_frameCounter == oneSecondFrames)
-    {
-      m_frameCounter = 0;
-      dynamic_cast<CartridgeMbc3*>(m_cartridge)->rtcCycle();
-    }
+  case 0x00:
+  case 0x01:
+  case 0x02:
+  case 0x03:
+  case 0x08:
+  case 0x09:
+  case 0x0F:
+  case 0x10:
+  case 0x11:
+  case 0x12:
+  case 0x13:
+  case 0x19:
+  case 0x1A:
+  case 0x1B:
+  case 0x1C:
+  case 0x1D:
+  case 0x1E: return true;
+  default:   return false;
   }
 }
 
-uint8 CartridgeSlot::readRom(const uint16 addr) const
+void CartridgeSlot::setBatterySaves(const bool enabled)
+{
+  m_batterySaves = enabled;
+}
+
+void CartridgeSlot::setRomCheats(const std::vector<RomCheat>& cheats)
+{
+  m_romCheats = cheats;
+  visit(m_cartridge, [this](auto& cartridge) { cartridge.setRomCheats(m_romCheats); });
+}
+
+void CartridgeSlot::setRtcClock(const uint64_t* emulatedClock)
 {
-  return m_cartridge->readRom(addr);
+  m_rtcClock = emulatedClock;
 }
 
-void CartridgeSlot::writeRom(const uint16 addr, const uint8 value)
+void CartridgeSlot::clock(const uint32 mCycles)
 {
-  m_cartridge->writeRom(addr, value);
+  visit(m_cartridge, [mCycles](auto& cartridge) { cartridge.clock(mCycles); });
 }
 
-uint8 CartridgeSlot::readRam(const uint16 addr) const
+void CartridgeSlot::saveState(StateWriter& state) const
 {
-  return m_cartridge->readRam(addr);
+  state.write(visit(m_cartridge, [](const auto& cartridge) { return cartridge.getRomImage()->getChecksum(); }));
+  visit(m_cartridge, [&state](const auto& cartridge) { cartridge.saveState(state); });
 }
 
-void CartridgeSlot::writeRam(const uint16 addr, const uint8 value)
+bool CartridgeSlot::loadState(StateReader& state)
 {
-  m_cartridge->writeRam(addr, value);
+  uint16 checksum{};
+  state.read(checksum);
+  if(checksum != visit(m_cartridge, [](const auto& cartridge) { return cartridge.getRomImage()->getChecksum(); }))
+    return false;
+  visit(m_cartridge, [&state](auto& cartridge) { cartridge.loadState(state); });
+  return !state.failed();
 }
@@ -1,8 +1,15 @@
 #pragma once
+#include "core/cartridge/cartridges.h"
 #include "type_alias.h"
 #include <filesystem>
+#include <memory>
+#include <type_traits>
+#include <variant>
+#include <vector>
 
-class Cartridge;
+class RomImage;
+class StateWriter;
+class StateReader;
 class CartridgeSlot
 {
 public:
@@ -12,21 +19,85 @@ public:
   const std::string& getCartridgeName() const;
 
   void reset();
-  void loadCartridge(const std::filesystem::path& filePath);
+  //without a patch path a .ips or .bps next to the rom with the same name is applied if there is one. compressed roms
+  //save and look for patches without the archive extension, game.gb.gz and game.zip both use game.sav
+  void loadCartridge(const std::filesystem::path& filePath, const std::filesystem::path& patchPath = {});
+  void loadCartridge(std::shared_ptr<const RomImage> rom, const std::string& name); //no battery save
   void reloadCartridge();
   bool hasCartridge() const;
-  void clockFrame();
+  static bool isSupported(const uint8 cartridgeType); //header byte 0x147
+  static bool isRomFile(const std::filesystem::path& path); //.gb, .gbc or either of them as .gz or .zip
+  void setBatterySaves(const bool enabled); //when disabled the next cartridges neither load nor write .sav files
+  void setRomCheats(const std::vector<RomCheat>& cheats); //applied to the cartridge and the next ones, remap after
+  void setRtcClock(const uint64_t* emulatedClock); //for the next cartridges, null runs their rtc on the host's clock
+  void clock(const uint32 mCycles); //once per frame
 
-  uint8 readRom(const uint16 addr) const;
-  void writeRom(const uint16 addr, const uint8 value);
-  uint8 readRam(const uint16 addr) const;
-  void writeRam(const uint16 addr, const uint8 value);
+  void saveState(StateWriter& state) const;
+  bool loadState(StateReader& state); //false if the state belongs to another rom
+
+  uint8 readRom(const uint16 addr) const
+  {
+    return visit(m_cartridge, [addr](const auto& cartridge) { return cartridge.readRom(addr); });
+  }
+  void writeRom(const uint16 addr, const uint8 value)
+  {
+    visit(m_cartridge, [addr, value](auto& cartridge) { cartridge.writeRom(addr, value); });
+  }
+  uint8 readRam(const uint16 addr) const
+  {
+    return visit(m_cartridge, [addr](const auto& cartridge) { return cartridge.readRam(addr); });
+  }
+  void writeRam(const uint16 addr, const uint8 value)
+  {
+    visit(m_cartridge, [addr, value](auto& cartridge) { cartridge.writeRam(addr, value); });
+  }
+  //see Cartridge::getRomPage, nullptr without a cartridge
+  const uint8* getRomPage(const uint16 addr) const
+  {
+    return visit(m_cartridge, [addr](const auto& cartridge) { return cartridge.getRomPage(addr); });
+  }
+  uint8* getRamPage(const uint16 addr) const
+  {
+    return visit(m_cartridge, [addr](const auto& cartridge) { return cartridge.getRamPage(addr); });
+  }
+  uint8* getRamWritePage(const uint16 addr) const
+  {
+    return visit(m_cartridge, [addr](const auto& cartridge) { return cartridge.getRamWritePage(addr); });
+  }
+  int getRomBank(const uint16 addr) const
+  {
+    return visit(m_cartridge, [addr](const auto& cartridge) { return cartridge.getRomBank(addr); });
+  }
+  int getRamBank() const
+  {
+    return visit(m_cartridge, [](const auto& cartridge) { return cartridge.getRamBank(); });
+  }
 
 private:
-  Cartridge* m_cartridge;
+  using CartridgeVariant = std::variant<std::monostate, Cartridge, CartridgeMbc1, CartridgeMbc3, CartridgeMbc5>;
+
+  //calls function with the cartridge as its mbc type, without a cartridge the result is value initialized
+  template<typename Variant, typename Function>
+  static auto visit(Variant& cartridge, Function function) -> decltype(function(std::get<Cartridge>(cartridge)))
+  {
+    using Result = decltype(function(std::get<Cartridge>(cartridge)));
+    return std::visit(
+      [&function]<typename Mbc>(Mbc& mbc) -> Result
+      {
+        if constexpr(std::is_same_v<std::remove_const_t<Mbc>, std::monostate>) return Result();
+        else return function(mbc);
+      },
+      cartridge);
+  }
+
+  void insertCartridge(std::shared_ptr<const RomImage> rom, const std::filesystem::path& savePath);
+
+  CartridgeVariant m_cartridge; //held by value, so every access is dispatched without virtual calls
   std::filesystem::path m_cartridgePath;
+  std::filesystem::path m_patchPath; //as given to loadCartridge
   std::string m_cartridgeName;
 
-  bool m_cartridgeHasClock;
-  uint8 m_frameCounter;
+  bool m_batterySaves;
+  const uint64_t* m_rtcClock;
+  std::vector<RomCheat> m_romCheats;
 };
@@ -1,11 +1,16 @@
 #include "core/cartridge/cartridges.h"
+#include "core/save_state.h"
 #include "memory_regions.h"
+#include <algorithm>
+#include <bit>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
-Cartridge::Cartridge(const std::filesystem::path& path, bool hasRam, bool hasBattery)
-  : m_rom{}
+Cartridge::Cartridge(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam,
+                     bool hasBattery, size_t footerSize)
+  : m_romImage{std::move(rom)}
+  , m_rom{m_romImage->data()}
   , m_ram{}
   , m_hasRam{hasRam}
   , m_hasBattery{hasBattery}
@@ -14,17 +19,15 @@ Cartridge::Cartridge(const std::filesystem::path& path, bool hasRam, bool hasBat
   , m_externalRamEnabled{}
   , m_romBankIndex{1}
   , m_ramBankIndex{}
+  , m_romBank0{}
+  , m_romBank1{}
+  , m_ramBank{}
+  , m_ramMask{}
+  , m_mappedRomBanks{}
+  , m_romCheats{}
+  , m_cheatBanks{}
 {
-  if(!loadRom(path)) return;
-
-  int romBanks{2};
-  constexpr uint16 romSizeAddress{0x148};
-  uint8 romSize{m_rom[romSizeAddress]};
-  if(romSize > 0 && romSize < 0x9) romBanks <<= romSize;
-  else if(romSize == 0x52) romBanks = 72;
-  else if(romSize == 0x53) romBanks = 80;
-  else if(romSize == 0x54) romBanks = 96;
-  m_romBanks = romBanks;
+  m_romBanks = static_cast<uint16>(m_romImage->size() / kb16); //the image is exactly the declared size
 
   uint32 ramSize{};
   if(m_hasRam)
@@ -50,83 +53,115 @@ Cartridge::Cartridge(const std::filesystem::path& path, bool hasRam, bool hasBat
   else m_ramBanks = 0;
 
   if(ramSize != kb2) ramSize = kb8 * m_ramBanks;
-  m_ram.resize(ramSize);
-  loadSave(path);
+  m_ram.open(ramSize, footerSize,
+             m_hasBattery && !path.empty() ? std::filesystem::path{path}.replace_extension(".sav")
+                                           : std::filesystem::path{});
+  mapBanks(0, 1, 0);
 }
 
-void Cartridge::save(const std::filesystem::path& path)
+void Cartridge::clock(const uint32 mCycles)
 {
-  if(!m_hasRam || !m_hasBattery) return;
-
-  std::filesystem::path save{path};
-  std::ofstream saveFile(save.replace_extension(".sav"), std::ios::binary);
-  if(saveFile.fail())
-  {
-    std::cerr << "Couldn't open save file\n";
-    return;
-  }
-  saveFile.write(reinterpret_cast<const char*>(m_ram.data()), m_ram.size());
+  m_ram.clock(mCycles);
 }
 
-void Cartridge::loadSave(const std::filesystem::path& path)
+const uint8* Cartridge::getRomPage(const uint16 addr) const
 {
-  if(!m_hasRam || !m_hasBattery) return;
-
-  std::filesystem::path savePath{path};
-  std::ifstream save(savePath.replace_extension(".sav"), std::ios::binary | std::ios::ate);
-  if(save.fail())
-  {
-    std::cout << "No save file found or couldn't open it\n";
-    return;
-  }
+  using namespace MemoryRegions;
+  if(addr <= romBank0.second) return m_romBank0 + (addr & 0xFF00);
+  else return m_romBank1 + ((addr - romBank1.first) & 0xFF00);
+}
 
-  auto size{save.tellg()};
-  save.seekg(0);
-  m_ram.resize(size);
-  save.read(reinterpret_cast<char*>(m_ram.data()), size);
-  save.close();
+uint8* Cartridge::getRamPage(const uint16 addr) const
+{
+  constexpr uint16 pageMask{0xFF};
+  if(!m_ramBank || m_ramMask < pageMask) return nullptr;
+  return m_ramBank + ((addr - MemoryRegions::externalRam.first) & m_ramMask & ~pageMask);
 }
 
-uint8 Cartridge::readRom(const uint16 addr)
+uint8* Cartridge::getRamWritePage(const uint16 addr) const
 {
-  return m_rom[addr];
+  return m_ram.hasSaveFile() ? nullptr : getRamPage(addr);
 }
 
-void Cartridge::writeRom(const uint16 addr, const uint8 value)
+int Cartridge::getRomBank(const uint16 addr) const
 {
-  return;
+  return m_mappedRomBanks[addr <= MemoryRegions::romBank0.second ? 0 : 1];
 }
 
-uint8 Cartridge::readRam(const uint16 addr)
+int Cartridge::getRamBank() const
 {
-  return 0xFF;
+  return m_ramBank ? static_cast<int>((m_ramBank - m_ram.data()) / kb8) : -1;
 }
 
-void Cartridge::writeRam(const uint16 addr, const uint8 value)
+void Cartridge::mapBanks(const uint16 romBank0, const uint16 romBank1, const uint8 ramBank)
 {
-  return;
+  m_mappedRomBanks = {romBank0, romBank1};
+  m_romBank0 = getRomBankBase(0, romBank0);
+  m_romBank1 = getRomBankBase(1, romBank1);
+
+  m_ramMask = static_cast<uint16>(std::bit_floor(std::min<size_t>(m_ram.size(), kb8)) - 1);
+  if(!m_externalRamEnabled || m_ram.empty()) m_ramBank = nullptr;
+  else m_ramBank = m_ram.data() + kb8 * (ramBank % std::max<size_t>(m_ram.size() / kb8, 1));
 }
 
-bool Cartridge::loadRom(const std::filesystem::path& path)
+const uint8* Cartridge::getRomBankBase(const int window, const uint16 bank)
 {
-  std::ifstream rom(path, std::ios::binary | std::ios::ate);
-  if(rom.fail())
+  const uint8* original{m_rom + kb16 * bank};
+  if(m_romCheats.empty()) return original;
+
+  auto [patched, inserted]{m_cheatBanks.try_emplace(static_cast<uint32>(window) << 16 | bank)};
+  if(inserted)
   {
-    std::cerr << "Failed to open file\n";
-    return false;
+    const uint16 windowStart{window ? MemoryRegions::romBank1.first : MemoryRegions::romBank0.first};
+    for(const RomCheat& cheat : m_romCheats)
+    {
+      const uint16 offset{static_cast<uint16>(cheat.address - windowStart)};
+      if(cheat.address < windowStart || offset >= kb16) continue;
+      if(cheat.compare && original[offset] != *cheat.compare) continue;
+      if(patched->second.empty()) patched->second.assign(original, original + kb16);
+      patched->second[offset] = cheat.value;
+    }
   }
+  return patched->second.empty() ? original : patched->second.data();
+}
+
+void Cartridge::setRomCheats(const std::vector<RomCheat>& cheats)
+{
+  m_romCheats = cheats;
+  m_cheatBanks.clear();
+  m_romBank0 = getRomBankBase(0, m_mappedRomBanks[0]);
+  m_romBank1 = getRomBankBase(1, m_mappedRomBanks[1]);
+}
+
+const std::shared_ptr<const RomImage>& Cartridge::getRomImage() const
+{
+  return m_romImage;
+}
 
-  auto size{rom.tellg()};
-  rom.seekg(0);
-  m_rom.resize(size);
-  rom.read(reinterpret_cast<char*>(m_rom.data()), size);
-  rom.close();
-  return true;
+void Cartridge::saveState(StateWriter& state) const
+{
+  state.write(static_cast<uint32>(m_ram.size())); //same layout as a container of bytes
+  state.writeBytes(m_ram.data(), m_ram.size());
+  state.write(m_externalRamEnabled);
+  state.write(m_romBankIndex);
+  state.write(m_ramBankIndex);
+}
+
+void Cartridge::loadState(StateReader& state)
+{
+  uint32 ramSize{};
+  state.read(ramSize);
+  if(ramSize != m_ram.size()) state.fail();
+  else state.readBytes(m_ram.data(), m_ram.size());
+  m_ram.markDirty();
+  state.read(m_externalRamEnabled);
+  state.read(m_romBankIndex);
+  state.read(m_ramBankIndex);
 }
 
-CartridgeMbc1::CartridgeMbc1(const std::filesystem::path& path, bool hasRam, bool hasBattery)
-  : Cartridge(path, hasRam, hasBattery)
-  , m_ramSize{}
+CartridgeMbc1::CartridgeMbc1(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam,
+                             bool hasBattery)
+  : Cartridge(std::move(rom), path, hasRam, hasBattery)
   , m_romBankIndexMask{}
   , m_modeFlag{}
 {
@@ -134,32 +169,20 @@ CartridgeMbc1::CartridgeMbc1(const std::filesystem::path& path, bool hasRam, boo
   constexpr uint16 kb32{0x8000};
   m_romBankIndexMask = std::min(romSize / kb32, 0b1'0000u);
   m_romBankIndexMask |= m_romBankIndexMask - 1; //fill every less significant bit
+  updateBanks();
+}
 
-  if(m_ramSize != kb2) m_ramSize = m_ramBanks * kb8;
+void CartridgeMbc1::saveState(StateWriter& state) const
+{
+  Cartridge::saveState(state);
+  state.write(m_modeFlag);
 }
 
-uint8 CartridgeMbc1::readRom(const uint16 addr)
+void CartridgeMbc1::loadState(StateReader& state)
 {
-  if(addr <= MemoryRegions::romBank0.second)
-  {
-    uint8 zeroBankIndex{};
-    if(m_romBanks <= 32)
-      ;
-    else if(m_romBanks == 64) zeroBankIndex = (m_ramBankIndex & 1) << 5;
-    else zeroBankIndex = m_ramBankIndex << 5;
-
-    if(m_modeFlag) return m_rom[kb16 * zeroBankIndex + addr];
-    else return m_rom[addr];
-  }
-  else
-  {
-    uint8 highBankIndex{};
-    if(m_romBanks <= 32) highBankIndex = m_romBankIndex & m_romBankIndexMask;
-    else if(m_romBanks == 64)
-      highBankIndex = ((m_romBankIndex & m_romBankIndexMask) & ~0b10'0000) | ((m_ramBankIndex & 1) << 5);
-    else highBankIndex = ((m_romBankIndex & m_romBankIndexMask) & ~0b110'0000) | (m_ramBankIndex << 5);
-    return m_rom[kb16 * highBankIndex + (addr - MemoryRegions::romBank1.first)];
-  }
+  Cartridge::loadState(state);
+  state.read(m_modeFlag);
+  updateBanks();
 }
 
 void CartridgeMbc1::writeRom(const uint16 addr, const uint8 value)
@@ -177,75 +200,68 @@ void CartridgeMbc1::writeRom(const uint16 addr, const uint8 value)
   }
   else if(addr <= ramBankEnd) m_ramBankIndex = value & 0b11;
   else m_modeFlag = value & 1; //so mode select
+  updateBanks();
 }
 
-uint8 CartridgeMbc1::readRam(const uint16 addr)
+void CartridgeMbc1::updateBanks()
 {
-  if(!m_externalRamEnabled) return 0xFF;
-
-  using namespace MemoryRegions;
-  if(m_ramBanks == 1) return m_ram[(addr - externalRam.first) % m_ramSize];
-  else return m_ram[m_modeFlag ? kb8 * m_ramBankIndex + (addr - externalRam.first) : addr - externalRam.first];
+  //mode 1 applies the upper bank bits to the 0x0000 window and banks the ram
+  mapBanks(getZeroBankIndex(), getHighBankIndex(), m_modeFlag ? m_ramBankIndex : 0);
 }
 
-void CartridgeMbc1::writeRam(const uint16 addr, const uint8 value)
+uint8 CartridgeMbc1::getZeroBankIndex() const
 {
-  if(!m_externalRamEnabled) return;
+  if(!m_modeFlag || m_romBanks <= 32) return 0;
+  else if(m_romBanks == 64) return (m_ramBankIndex & 1) << 5;
+  else return m_ramBankIndex << 5;
+}
 
-  using namespace MemoryRegions;
-  if(m_ramBanks == 1) m_ram[(addr - externalRam.first) % m_ramSize] = value;
-  else m_ram[m_modeFlag ? kb8 * m_ramBankIndex + (addr - externalRam.first) : addr - externalRam.first] = value;
+uint8 CartridgeMbc1::getHighBankIndex() const
+{
+  if(m_romBanks <= 32) return m_romBankIndex & m_romBankIndexMask;
+  else if(m_romBanks == 64)
+    return ((m_romBankIndex & m_romBankIndexMask) & ~0b10'0000) | ((m_ramBankIndex & 1) << 5);
+  else return ((m_romBankIndex & m_romBankIndexMask) & ~0b110'0000) | (m_ramBankIndex << 5);
 }
 
-CartridgeMbc3::CartridgeMbc3(const std::filesystem::path& path, bool hasRam, bool hasBattery, bool hasRtc)
-  : Cartridge(path, hasRam, hasBattery)
+CartridgeMbc3::CartridgeMbc3(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam,
+                             bool hasBattery, bool hasRtc, const uint64_t* rtcClock)
+  : Cartridge(std::move(rom), path, hasRam, hasBattery, hasRtc ? Rtc::footerSize : 0)
   , m_hasRtc{hasRtc}
-  , m_mappedRtcRegister{maxRtcRegister}
-  , m_rtcRegisters{}
-  , m_rtcRegistersCopy{0xFF, 0xFF, 0xFF, 0xFF, 0xFF}
+  , m_rtc{rtcClock}
+  , m_mappedRtcRegister{-1}
   , m_lastWriteZero{}
 {
+  if(m_hasRtc)
+  {
+    m_rtc.loadFooter(m_ram.footer());
+    m_rtc.saveFooter(m_ram.footer()); //a new save records when the clock started
+    m_ram.markDirty();
+  }
+  updateBanks();
 }
 
-void CartridgeMbc3::rtcCycle()
+void CartridgeMbc3::saveState(StateWriter& state) const
 {
-  if(constexpr uint8 timerHaltBit{0b0100'0000}; m_rtcRegisters[daysHigh] & timerHaltBit) return;
-
-  if(++m_rtcRegisters[seconds] == 60)
-  {
-    m_rtcRegisters[seconds] = 0;
-    if(++m_rtcRegisters[minutes] == 60)
-    {
-      m_rtcRegisters[minutes] = 0;
-      if(++m_rtcRegisters[hours] == 24)
-      {
-        m_rtcRegisters[hours] = 0;
-        if(++m_rtcRegisters[daysLow] == 0)
-        {
-          if(m_rtcRegisters[daysHigh] & 1) //so if there is an overflow exceeding 9 bits
-          {
-            m_rtcRegisters[daysHigh] &= ~1;
-            constexpr uint8 daysCarryBit{0x80};
-            m_rtcRegisters[daysHigh] |= daysCarryBit;
-          }
-          else m_rtcRegisters[daysHigh] |= 1;
-        }
-      }
-    }
-  }
+  Cartridge::saveState(state);
+  state.write(m_mappedRtcRegister);
+  m_rtc.saveState(state);
+  state.write(m_lastWriteZero);
 }
 
-uint8 CartridgeMbc3::readRom(const uint16 addr)
+void CartridgeMbc3::loadState(StateReader& state)
 {
-  using namespace MemoryRegions;
-  if(addr <= romBank0.second) return m_rom[addr];
-  else return m_rom[kb16 * m_romBankIndex + (addr - kb16)];
+  Cartridge::loadState(state);
+  state.read(m_mappedRtcRegister);
+  m_rtc.loadState(state);
+  state.read(m_lastWriteZero);
+  if(m_hasRtc) m_rtc.saveFooter(m_ram.footer());
+  updateBanks();
 }
 
 void CartridgeMbc3::writeRom(const uint16 addr, const uint8 value)
 {
   constexpr uint16 ramBankRtcSelectEnd{0x5FFF};
-  constexpr uint16 rtcDataLatchEnd{0x7FFF};
   if(addr <= enableRamEnd)
   {
     if((value & 0xF) == 0xA && m_hasRam) m_externalRamEnabled = true;
@@ -255,63 +271,66 @@ void CartridgeMbc3::writeRom(const uint16 addr, const uint8 value)
   {
     if((value & 0x7F) == 0) m_romBankIndex = 1; //rom bank index is 7 bits here
     else m_romBankIndex = value & 0x7F;
-    if(m_romBankIndex > m_romBanks) m_romBankIndex = m_romBanks;
+    if(m_romBankIndex >= m_romBanks) m_romBankIndex &= m_romBanks - 1;
   }
   else if(addr <= ramBankRtcSelectEnd)
   {
     if(value < 4) //because ram index is 2 bits
     {
       m_ramBankIndex = value;
-      m_mappedRtcRegister = maxRtcRegister;
+      m_mappedRtcRegister = -1;
     }
-    else if(m_hasRtc && value > (rtcRegisterOffset - 1) && value < (maxRtcRegister + rtcRegisterOffset))
-      m_mappedRtcRegister = static_cast<RtcRegister>(value - rtcRegisterOffset);
+    else if(m_hasRtc && value >= rtcRegisterOffset && value < Rtc::registerCount + rtcRegisterOffset)
+      m_mappedRtcRegister = value - rtcRegisterOffset;
   }
-  else //so rtc copy end
+  else //so rtc latch
   {
     if(value == 0) m_lastWriteZero = true;
     else
     {
-      if(m_lastWriteZero && value == 1) m_rtcRegistersCopy = m_rtcRegisters;
+      if(m_lastWriteZero && value == 1) m_rtc.latch();
       m_lastWriteZero = false;
     }
   }
+  updateBanks();
 }
 
-uint8 CartridgeMbc3::readRam(const uint16 addr)
+uint8 CartridgeMbc3::readRam(const uint16 addr) const
 {
-  if(m_mappedRtcRegister < maxRtcRegister)
-    return m_rtcRegistersCopy[m_mappedRtcRegister] | ~rtcRegistersBitmasks[m_mappedRtcRegister];
-
-  if(!m_externalRamEnabled) return 0xFF;
-  return m_ram[kb8 * m_ramBankIndex + (addr - MemoryRegions::externalRam.first)];
+  if(m_mappedRtcRegister >= 0) return m_rtc.read(static_cast<Rtc::Register>(m_mappedRtcRegister));
+  return Cartridge::readRam(addr);
 }
 
 void CartridgeMbc3::writeRam(const uint16 addr, const uint8 value)
 {
-  if(m_mappedRtcRegister < maxRtcRegister)
+  if(m_mappedRtcRegister >= 0)
   {
-    uint8 maskedValue{static_cast<uint8>(value & rtcRegistersBitmasks[m_mappedRtcRegister])};
-    m_rtcRegistersCopy[m_mappedRtcRegister] = maskedValue;
-    m_rtcRegisters[m_mappedRtcRegister] = maskedValue;
+    m_rtc.write(static_cast<Rtc::Register>(m_mappedRtcRegister), value);
+    m_rtc.saveFooter(m_ram.footer()); //the clock only changes course when written
+    m_ram.markDirty();
     return;
   }
+  Cartridge::writeRam(addr, value);
+}
 
-  if(!m_externalRamEnabled) return;
-  m_ram[kb8 * m_ramBankIndex + (addr - MemoryRegions::externalRam.first)] = value;
+void CartridgeMbc3::updateBanks()
+{
+  mapBanks(0, m_romBankIndex, m_ramBankIndex);
+  if(m_mappedRtcRegister >= 0) m_ramBank = nullptr;
 }
 
-CartridgeMbc5::CartridgeMbc5(const std::filesystem::path& path, bool hasRam, bool hasBattery, bool hasRumble)
-  : Cartridge(path, hasRam, hasBattery)
+CartridgeMbc5::CartridgeMbc5(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam,
+                             bool hasBattery, bool hasRumble)
+  : Cartridge(std::move(rom), path, hasRam, hasBattery)
   , m_hasRumble{hasRumble}
 {
+  updateBanks();
 }
 
-uint8 CartridgeMbc5::readRom(const uint16 addr)
+void CartridgeMbc5::loadState(StateReader& state)
 {
-  using namespace MemoryRegions;
-  if(addr <= MemoryRegions::romBank0.second) return m_rom[addr];
-  else return m_rom[romBank1.first * m_romBankIndex + (addr - romBank1.first)];
+  Cartridge::loadState(state);
+  updateBanks();
 }
 
 void CartridgeMbc5::writeRom(const uint16 addr, const uint8 value)
@@ -334,18 +353,10 @@ void CartridgeMbc5::writeRom(const uint16 addr, const uint8 value)
     m_romBankIndex &= m_romBanks - 1;
   }
   else if(addr <= ramBankEnd) m_ramBankIndex = value & (m_hasRumble ? 0b111 : 0xF);
+  updateBanks();
 }
 
-uint8 CartridgeMbc5::readRam(const uint16 addr)
+void CartridgeMbc5::updateBanks()
 {
-  if(!m_externalRamEnabled) return 0xFF;
-
-  return m_ram[kb8 * m_ramBankIndex + (addr - MemoryRegions::externalRam.first)];
-}
-
-void CartridgeMbc5::writeRam(const uint16 addr, const uint8 value)
-{
-  if(!m_externalRamEnabled) return;
-
-  m_ram[kb8 * m_ramBankIndex + (addr - MemoryRegions::externalRam.first)] = value;
+  mapBanks(0, m_romBankIndex, m_ramBankIndex);
 }
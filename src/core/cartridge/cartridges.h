@@ -1,31 +1,77 @@
 #pragma once
+#include "core/cartridge/battery_ram.h"
+#include "core/cartridge/rom_image.h"
+#include "core/cartridge/rtc.h"
+#include "core/cheats.h"
+#include "memory_regions.h"
 #include "type_alias.h"
 #include <array>
 #include <filesystem>
+#include <map>
+#include <memory>
 #include <vector>
 
+class StateWriter;
+class StateReader;
+
+//the mbc types are held by value in CartridgeSlot and dispatched statically, so nothing here is virtual. subclasses
+//hide the members they change
 class Cartridge
 {
 public:
-  Cartridge(const std::filesystem::path& path, bool hasRam = false, bool hasBattery = false);
-  virtual ~Cartridge() = default;
-
-  void save(const std::filesystem::path& path);
-  void loadSave(const std::filesystem::path& path);
-
-  virtual uint8 readRom(const uint16 addr);
-  virtual void writeRom(const uint16 addr, const uint8 value);
-  virtual uint8 readRam(const uint16 addr);
-  virtual void writeRam(const uint16 addr, const uint8 value);
+  //path is where the battery save lives, empty for roms loaded from memory. footerSize bytes after the ram are saved
+  //along with it
+  Cartridge(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam = false,
+            bool hasBattery = false, size_t footerSize = 0);
+  Cartridge(const Cartridge&) = delete; //the bank pointers point into the object itself
+  Cartridge& operator=(const Cartridge&) = delete;
+
+  const std::shared_ptr<const RomImage>& getRomImage() const;
+  void clock(const uint32 mCycles); //once per frame, lets the battery ram flush
+  //banks the cheats change are mapped as patched copies, made the first time the bank is mapped into a window
+  void setRomCheats(const std::vector<RomCheat>& cheats);
+
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
+  uint8 readRom(const uint16 addr) const
+  {
+    using namespace MemoryRegions;
+    return addr <= romBank0.second ? m_romBank0[addr] : m_romBank1[addr - romBank1.first];
+  }
+  void writeRom(const uint16 addr, const uint8 value) {}
+  uint8 readRam(const uint16 addr) const
+  {
+    return m_ramBank ? m_ramBank[(addr - MemoryRegions::externalRam.first) & m_ramMask] : 0xFF;
+  }
+  void writeRam(const uint16 addr, const uint8 value)
+  {
+    if(!m_ramBank) return;
+    m_ramBank[(addr - MemoryRegions::externalRam.first) & m_ramMask] = value;
+    m_ram.markDirty();
+  }
+
+  //base of the 256 byte page holding addr with the current banking, nullptr if the page has to go through
+  //readRam/writeRam. the mmu reads these pages directly and asks again after every rom write
+  const uint8* getRomPage(const uint16 addr) const;
+  uint8* getRamPage(const uint16 addr) const;
+  uint8* getRamWritePage(const uint16 addr) const; //nullptr for saved ram, so only real writes make it dirty
+  int getRomBank(const uint16 addr) const; //bank currently visible at addr
+  int getRamBank() const;                  //-1 while no ram bank is mapped
 
 protected:
+  //points the windows at the given banks, ram is only mapped while enabled and out of range banks wrap around
+  void mapBanks(const uint16 romBank0, const uint16 romBank1, const uint8 ramBank);
+  const uint8* getRomBankBase(const int window, const uint16 bank); //window 0 at 0x0000, 1 at 0x4000
+
   static constexpr uint16 kb2{0x800};
   static constexpr uint16 kb8{0x2000};
   static constexpr uint16 kb16{0x4000};
   static constexpr uint16 enableRamEnd{0x1FFF};
 
-  std::vector<uint8> m_rom;
-  std::vector<uint8> m_ram;
+  std::shared_ptr<const RomImage> m_romImage; //shared with every cartridge of the same rom
+  const uint8* m_rom;
+  BatteryRam m_ram; //backed by the .sav file for battery cartridges with a save path
   bool m_hasRam;
   bool m_hasBattery;
   uint16 m_romBanks;
@@ -35,22 +81,34 @@ protected:
   uint16 m_romBankIndex;
   uint8 m_ramBankIndex;
 
-private:
-  bool loadRom(const std::filesystem::path& path);
+  //banks currently visible at 0x0000, 0x4000 and 0xA000, only updated when the bank registers change
+  const uint8* m_romBank0;
+  const uint8* m_romBank1;
+  uint8* m_ramBank; //nullptr while ram is disabled or something else is mapped there
+  uint16 m_ramMask; //smaller rams are mirrored across the window
+  std::array<uint16, 2> m_mappedRomBanks;
+
+  std::vector<RomCheat> m_romCheats;
+  //patched bank per window and bank, empty when the cheats leave the bank as it is
+  std::map<uint32, std::vector<uint8>> m_cheatBanks;
 };
 
 class CartridgeMbc1 : public Cartridge
 {
 public:
-  CartridgeMbc1(const std::filesystem::path& path, bool hasRam = false, bool hasBattery = false);
+  CartridgeMbc1(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam = false,
+                bool hasBattery = false);
+
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
 
-  uint8 readRom(const uint16 addr) override final;
-  void writeRom(const uint16 addr, const uint8 value) override final;
-  uint8 readRam(const uint16 addr) override final;
-  void writeRam(const uint16 addr, const uint8 value) override final;
+  void writeRom(const uint16 addr, const uint8 value);
 
 private:
-  uint32 m_ramSize;
+  void updateBanks();
+  uint8 getZeroBankIndex() const;
+  uint8 getHighBankIndex() const;
+
   uint16 m_romBankIndexMask;
   bool m_modeFlag;
 };
@@ -58,48 +116,40 @@ private:
 class CartridgeMbc3 : public Cartridge
 {
 public:
-  CartridgeMbc3(const std::filesystem::path& path, bool hasRtc = false, bool hasBattery = false, bool hasClock = false);
+  //rtcClock is the emulated clock the rtc runs on, null for the host's clock
+  CartridgeMbc3(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam = false,
+                bool hasBattery = false, bool hasRtc = false, const uint64_t* rtcClock = nullptr);
 
-  void rtcCycle();
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
 
-  uint8 readRom(const uint16 addr) override final;
-  void writeRom(const uint16 addr, const uint8 value) override final;
-  uint8 readRam(const uint16 addr) override final;
-  void writeRam(const uint16 addr, const uint8 value) override final;
+  void writeRom(const uint16 addr, const uint8 value);
+  uint8 readRam(const uint16 addr) const;
+  void writeRam(const uint16 addr, const uint8 value);
 
 private:
-  enum RtcRegister
-  {
-    seconds,
-    minutes,
-    hours,
-    daysLow,
-    daysHigh,
-    maxRtcRegister,
-  };
-
-  static constexpr int rtcRegisterOffset{8};
-  static constexpr std::array<uint8, 5> rtcRegistersBitmasks //& bitmasks
-    {0b0011'1111, 0b0011'1111, 0b0001'1111, 0b1111'1111, 0b1100'0001};
+  void updateBanks();
 
-  bool m_hasRtc;
+  static constexpr uint8 rtcRegisterOffset{8};
 
-  RtcRegister m_mappedRtcRegister;
-  std::array<uint8, 5> m_rtcRegisters;
-  std::array<uint8, 5> m_rtcRegistersCopy;
+  bool m_hasRtc;
+  Rtc m_rtc;
+  int m_mappedRtcRegister; //-1 while ram is selected
   bool m_lastWriteZero;
 };
 
 class CartridgeMbc5 : public Cartridge
 {
 public:
-  CartridgeMbc5(const std::filesystem::path& path, bool hasRam = false, bool hasBattery = false, bool hasRumble = false);
+  CartridgeMbc5(std::shared_ptr<const RomImage> rom, const std::filesystem::path& path, bool hasRam = false,
+                bool hasBattery = false, bool hasRumble = false);
 
-  uint8 readRom(const uint16 addr) override final;
-  void writeRom(const uint16 addr, const uint8 value) override final;
-  uint8 readRam(const uint16 addr) override final;
-  void writeRam(const uint16 addr, const uint8 value) override final;
+  void loadState(StateReader& state);
+
+  void writeRom(const uint16 addr, const uint8 value);
 
 private:
+  void updateBanks();
+
   bool m_hasRumble;
 };
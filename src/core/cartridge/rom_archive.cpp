@@ -0,0 +1,490 @@
+#include "core/cartridge/rom_archive.h"
+#include "core/cartridge/rom_image.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+
+namespace
+{
+constexpr size_t maxRomSize{8 << 20}; //the largest rom size code
+
+uint32 readLittleEndian(const uint8* bytes, const int size)
+{
+  uint32 value{};
+  for(int i{size - 1}; i >= 0; --i) value = value << 8 | bytes[i];
+  return value;
+}
+
+//deflate packs its fields starting from the lowest bit of each byte
+class BitReader
+{
+public:
+  BitReader(const uint8* data, const size_t size)
+    : m_next{data}
+    , m_end{data + size}
+    , m_bits{}
+    , m_count{}
+  {
+  }
+
+  //tops the buffer up to at least 57 bits while there is input, enough for a whole length and distance pair
+  void refill()
+  {
+    while(m_count <= 56 && m_next != m_end)
+    {
+      m_bits |= uint64_t{*m_next++} << m_count;
+      m_count += 8;
+    }
+  }
+
+  bool has(const int count) const { return m_count >= count; }
+  uint32 peek(const int count) const { return static_cast<uint32>(m_bits & ((uint64_t{1} << count) - 1)); }
+  uint32 bit(const int index) const { return static_cast<uint32>(m_bits >> index) & 1; }
+  void drop(const int count)
+  {
+    m_bits >>= count;
+    m_count -= count;
+  }
+  uint32 take(const int count)
+  {
+    const uint32 value{peek(count)};
+    drop(count);
+    return value;
+  }
+  bool read(const int count, uint32& value)
+  {
+    refill();
+    if(!has(count)) return false;
+    value = take(count);
+    return true;
+  }
+
+  //stored blocks start at the next byte, the whole bytes still buffered go back to the input
+  void alignToByte()
+  {
+    drop(m_count % 8);
+    m_next -= m_count / 8;
+    m_bits = 0;
+    m_count = 0;
+  }
+  const uint8* position() const { return m_next; } //only meaningful after alignToByte
+  size_t remaining() const { return static_cast<size_t>(m_end - m_next); }
+  void skip(const size_t bytes) { m_next += bytes; }
+
+private:
+  const uint8* m_next;
+  const uint8* m_end;
+  uint64_t m_bits;
+  int m_count;
+};
+
+//canonical huffman code: codes up to fastBits long are a single table lookup, longer ones are walked bit by bit
+class Huffman
+{
+public:
+  //false if the lengths describe more codes than fit, incomplete codes fail when an unused code is read
+  bool build(const uint8* lengths, const int count)
+  {
+    m_counts.fill(0);
+    for(int symbol{}; symbol < count; ++symbol) ++m_counts[lengths[symbol]];
+    m_counts[0] = 0;
+    int left{1};
+    for(int length{1}; length <= maxBits; ++length)
+    {
+      left = (left << 1) - m_counts[length];
+      if(left < 0) return false;
+    }
+
+    std::array<uint16, maxBits + 1> offsets{};
+    for(int length{1}; length < maxBits; ++length) offsets[length + 1] = offsets[length] + m_counts[length];
+    for(int symbol{}; symbol < count; ++symbol)
+      if(lengths[symbol]) m_symbols[offsets[lengths[symbol]]++] = static_cast<uint16>(symbol);
+
+    //codes are read from their first bit on, so the table is indexed by the reversed code
+    m_fast.fill(0);
+    uint32 code{};
+    int index{};
+    for(int length{1}; length <= fastBits; ++length)
+    {
+      for(int i{}; i < m_counts[length]; ++i, ++code, ++index)
+      {
+        uint32 reversed{};
+        for(int bit{}; bit < length; ++bit) reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+        for(uint32 entry{reversed}; entry < m_fast.size(); entry += 1u << length)
+          m_fast[entry] = static_cast<uint16>(m_symbols[index] << 4 | length);
+      }
+      code <<= 1;
+    }
+    return true;
+  }
+
+  //-1 for unused codes and input that ends mid code
+  int decode(BitReader& input) const
+  {
+    const uint16 entry{m_fast[input.peek(fastBits)]};
+    if(entry)
+    {
+      const int length{entry & 0xF};
+      if(!input.has(length)) return -1;
+      input.drop(length);
+      return entry >> 4;
+    }
+
+    int code{};
+    int first{}; //first code of the current length
+    int index{}; //first symbol of the current length
+    for(int length{1}; length <= maxBits; ++length)
+    {
+      if(!input.has(length)) return -1;
+      code |= static_cast<int>(input.bit(length - 1));
+      const int count{m_counts[length]};
+      if(code - first < count)
+      {
+        input.drop(length);
+        return m_symbols[index + code - first];
+      }
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    return -1;
+  }
+
+private:
+  static constexpr int maxBits{15};
+  static constexpr int fastBits{9};
+
+  std::array<uint16, 1 << fastBits> m_fast; //symbol << 4 | length, 0 when the code is longer
+  std::array<uint16, maxBits + 1> m_counts;
+  std::array<uint16, 288> m_symbols; //ordered by code
+};
+
+constexpr std::array<uint16, 29> lengthBases{3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8, 29> lengthExtras{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<uint16, 30> distanceBases{1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                               33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                               1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<uint8, 30> distanceExtras{0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+const std::pair<Huffman, Huffman>& fixedCodes()
+{
+  static const std::pair<Huffman, Huffman> codes{[]
+  {
+    std::pair<Huffman, Huffman> codes{};
+    std::array<uint8, 288> lengths{};
+    std::fill(lengths.begin(), lengths.begin() + 144, 8);
+    std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+    std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+    std::fill(lengths.begin() + 280, lengths.end(), 8);
+    codes.first.build(lengths.data(), static_cast<int>(lengths.size()));
+    std::fill(lengths.begin(), lengths.begin() + distanceBases.size(), 5);
+    codes.second.build(lengths.data(), static_cast<int>(distanceBases.size()));
+    return codes;
+  }()};
+  return codes;
+}
+
+bool readDynamicCodes(BitReader& input, Huffman& literals, Huffman& distances)
+{
+  uint32 literalCount{};
+  uint32 distanceCount{};
+  uint32 codeLengthCount{};
+  if(!input.read(5, literalCount) || !input.read(5, distanceCount) || !input.read(4, codeLengthCount)) return false;
+  literalCount += 257;
+  distanceCount += 1;
+  codeLengthCount += 4;
+  if(literalCount > 286 || distanceCount > distanceBases.size()) return false;
+
+  constexpr std::array<uint8, 19> codeLengthOrder{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  std::array<uint8, codeLengthOrder.size()> codeLengthLengths{};
+  for(uint32 i{}; i < codeLengthCount; ++i)
+  {
+    uint32 length{};
+    if(!input.read(3, length)) return false;
+    codeLengthLengths[codeLengthOrder[i]] = static_cast<uint8>(length);
+  }
+  Huffman codeLengths{};
+  if(!codeLengths.build(codeLengthLengths.data(), static_cast<int>(codeLengthLengths.size()))) return false;
+
+  //the literal and distance lengths are one sequence, repeats can cross from one into the other
+  std::array<uint8, 286 + distanceBases.size()> lengths{};
+  const uint32 total{literalCount + distanceCount};
+  uint32 index{};
+  while(index < total)
+  {
+    input.refill();
+    const int symbol{codeLengths.decode(input)};
+    if(symbol < 0) return false;
+    if(symbol < 16)
+    {
+      lengths[index++] = static_cast<uint8>(symbol);
+      continue;
+    }
+    uint32 repeat{};
+    uint8 value{};
+    if(symbol == 16)
+    {
+      if(index == 0 || !input.read(2, repeat)) return false;
+      value = lengths[index - 1];
+      repeat += 3;
+    }
+    else if(symbol == 17)
+    {
+      if(!input.read(3, repeat)) return false;
+      repeat += 3;
+    }
+    else
+    {
+      if(!input.read(7, repeat)) return false;
+      repeat += 11;
+    }
+    if(repeat > total - index) return false;
+    std::fill_n(lengths.begin() + index, repeat, value);
+    index += repeat;
+  }
+  if(lengths[256] == 0) return false; //a block needs its end code
+
+  return literals.build(lengths.data(), static_cast<int>(literalCount)) &&
+         distances.build(lengths.data() + literalCount, static_cast<int>(distanceCount));
+}
+
+bool inflateBlock(BitReader& input, const Huffman& literals, const Huffman& distances, uint8* output,
+                  const size_t outputSize, size_t& written)
+{
+  while(true)
+  {
+    input.refill();
+    const int symbol{literals.decode(input)};
+    if(symbol < 0) return false;
+    if(symbol < 256)
+    {
+      if(written == outputSize) return false;
+      output[written++] = static_cast<uint8>(symbol);
+      continue;
+    }
+    if(symbol == 256) return true;
+
+    const size_t lengthCode{static_cast<size_t>(symbol - 257)};
+    if(lengthCode >= lengthBases.size() || !input.has(lengthExtras[lengthCode])) return false;
+    const size_t length{lengthBases[lengthCode] + input.take(lengthExtras[lengthCode])};
+    const int distanceCode{distances.decode(input)};
+    if(distanceCode < 0 || distanceCode >= static_cast<int>(distanceBases.size()) ||
+       !input.has(distanceExtras[distanceCode]))
+      return false;
+    const size_t distance{distanceBases[distanceCode] + input.take(distanceExtras[distanceCode])};
+    if(distance > written || length > outputSize - written) return false;
+
+    uint8* to{output + written};
+    const uint8* from{to - distance};
+    if(distance >= length) std::memcpy(to, from, length);
+    else for(size_t i{}; i < length; ++i) to[i] = from[i]; //a close match repeats the bytes it is writing
+    written += length;
+  }
+}
+
+//a raw deflate stream that has to produce exactly outputSize bytes. the output doubles as the history window, so
+//nothing is buffered between the input and the rom
+bool inflate(const uint8* data, const size_t size, uint8* output, const size_t outputSize)
+{
+  BitReader input{data, size};
+  Huffman literals{};
+  Huffman distances{};
+  size_t written{};
+  bool last{};
+  while(!last)
+  {
+    uint32 header{};
+    if(!input.read(3, header)) return false;
+    last = header & 1;
+    switch(header >> 1)
+    {
+    case 0: //stored
+    {
+      input.alignToByte();
+      uint32 length{};
+      uint32 complement{};
+      if(!input.read(16, length) || !input.read(16, complement) || length != (~complement & 0xFFFF)) return false;
+      input.alignToByte();
+      if(length > input.remaining() || length > outputSize - written) return false;
+      std::memcpy(output + written, input.position(), length);
+      input.skip(length);
+      written += length;
+      break;
+    }
+    case 1:
+      if(!inflateBlock(input, fixedCodes().first, fixedCodes().second, output, outputSize, written)) return false;
+      break;
+    case 2:
+      if(!readDynamicCodes(input, literals, distances) ||
+         !inflateBlock(input, literals, distances, output, outputSize, written))
+        return false;
+      break;
+    default: return false;
+    }
+  }
+  return written == outputSize;
+}
+
+bool checkSize(const size_t size)
+{
+  if(size <= maxRomSize) return true;
+  std::cerr << "Compressed rom is larger than any cartridge\n";
+  return false;
+}
+
+std::optional<RomArchive::Member> locateGzip(const uint8* data, const size_t size)
+{
+  constexpr size_t headerSize{10};
+  constexpr size_t footerSize{8}; //crc32 and size
+  constexpr uint8 deflate{8};
+  enum Flags : uint8
+  {
+    headerCrc = 1 << 1,
+    extra = 1 << 2,
+    name = 1 << 3,
+    comment = 1 << 4,
+  };
+  if(size < headerSize + footerSize || data[0] != 0x1F || data[1] != 0x8B || data[2] != deflate)
+  {
+    std::cerr << "Not a gzip file\n";
+    return std::nullopt;
+  }
+
+  const uint8 flags{data[3]};
+  const size_t streamEnd{size - footerSize};
+  size_t position{headerSize};
+  if(flags & extra)
+  {
+    if(position + 2 > streamEnd) position = size; //reported below
+    else position += 2 + readLittleEndian(data + position, 2);
+  }
+  for(const uint8 text : {name, comment})
+  {
+    if(!(flags & text)) continue;
+    while(position < streamEnd && data[position] != 0) ++position;
+    ++position; //the terminating zero
+  }
+  if(flags & headerCrc) position += 2;
+  if(position > streamEnd)
+  {
+    std::cerr << "Malformed gzip file\n";
+    return std::nullopt;
+  }
+
+  //a single member whose footer holds the size, so the rom is allocated once and inflated in place
+  const size_t romSize{readLittleEndian(data + streamEnd + 4, 4)};
+  if(!checkSize(romSize)) return std::nullopt;
+  return RomArchive::Member{data + position, streamEnd - position, romSize, readLittleEndian(data + streamEnd, 4), true};
+}
+
+std::optional<RomArchive::Member> locateZip(const uint8* data, const size_t size)
+{
+  constexpr uint32 endSignature{0x06054B50};
+  constexpr uint32 entrySignature{0x02014B50};
+  constexpr uint32 localSignature{0x04034B50};
+  constexpr size_t endSize{22};
+  constexpr size_t entrySize{46};
+  constexpr size_t localSize{30};
+
+  //the end record is followed by a comment of up to 64KB
+  size_t end{size >= endSize ? size - endSize : 0};
+  const size_t searchStart{end > 0xFFFF ? end - 0xFFFF : 0};
+  while(end > searchStart && readLittleEndian(data + end, 4) != endSignature) --end;
+  if(size < endSize || readLittleEndian(data + end, 4) != endSignature)
+  {
+    std::cerr << "Not a zip file\n";
+    return std::nullopt;
+  }
+
+  const uint32 entries{readLittleEndian(data + end + 10, 2)};
+  size_t position{readLittleEndian(data + end + 16, 4)};
+  for(uint32 entry{}; entry < entries; ++entry)
+  {
+    if(position + entrySize > end || readLittleEndian(data + position, 4) != entrySignature) break;
+    const uint32 flags{readLittleEndian(data + position + 8, 2)};
+    const uint32 method{readLittleEndian(data + position + 10, 2)};
+    const uint32 crc{readLittleEndian(data + position + 16, 4)};
+    const size_t compressedSize{readLittleEndian(data + position + 20, 4)};
+    const size_t romSize{readLittleEndian(data + position + 24, 4)};
+    const size_t nameLength{readLittleEndian(data + position + 28, 2)};
+    const size_t local{readLittleEndian(data + position + 42, 4)};
+    const size_t next{position + entrySize + nameLength + readLittleEndian(data + position + 30, 2) +
+                      readLittleEndian(data + position + 32, 2)};
+    if(position + entrySize + nameLength > end) break;
+
+    std::string name(reinterpret_cast<const char*>(data + position + entrySize), nameLength);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    position = next;
+    if(!name.ends_with(".gb") && !name.ends_with(".gbc")) continue;
+
+    constexpr uint32 encrypted{1};
+    constexpr uint32 stored{0};
+    constexpr uint32 deflated{8};
+    if(flags & encrypted || (method != stored && method != deflated))
+    {
+      std::cerr << "Unsupported zip compression for " << name << '\n';
+      return std::nullopt;
+    }
+    if(!checkSize(romSize)) return std::nullopt;
+    if(local + localSize > size || readLittleEndian(data + local, 4) != localSignature)
+    {
+      std::cerr << "Malformed zip file\n";
+      return std::nullopt;
+    }
+    const size_t start{local + localSize + readLittleEndian(data + local + 26, 2) +
+                       readLittleEndian(data + local + 28, 2)};
+    if(start > size || compressedSize > size - start || (method == stored && compressedSize != romSize))
+    {
+      std::cerr << "Malformed zip file\n";
+      return std::nullopt;
+    }
+    return RomArchive::Member{data + start, compressedSize, romSize, crc, method == deflated};
+  }
+  std::cerr << "Zip file holds no .gb or .gbc rom\n";
+  return std::nullopt;
+}
+} //namespace
+
+RomArchive::Format RomArchive::detect(const std::filesystem::path& path)
+{
+  std::string extension{path.extension().string()};
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if(extension == ".gz") return Format::gzip;
+  if(extension == ".zip") return Format::zip;
+  return Format::none;
+}
+
+std::optional<RomArchive::Member> RomArchive::locate(const Format format, const uint8* data, const size_t size)
+{
+  switch(format)
+  {
+  case Format::gzip: return locateGzip(data, size);
+  case Format::zip: return locateZip(data, size);
+  default: return std::nullopt;
+  }
+}
+
+bool RomArchive::extract(const Member& member, std::vector<uint8>& rom)
+{
+  rom.resize(member.romSize);
+  if(!member.deflated) std::memcpy(rom.data(), member.data, member.romSize);
+  else if(!inflate(member.data, member.size, rom.data(), rom.size()))
+  {
+    std::cerr << "Malformed compressed rom\n";
+    return false;
+  }
+  if(RomImage::crc32(rom.data(), rom.size()) != member.crc)
+  {
+    std::cerr << "Compressed rom checksum doesn't match\n";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "type_alias.h"
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+//gzip and zip compressed roms, RomImage inflates them from the file mapping straight into the image buffer
+namespace RomArchive
+{
+enum class Format
+{
+  none,
+  gzip,
+  zip,
+};
+Format detect(const std::filesystem::path& path); //by extension, a rom's first bytes can look like any magic
+
+//where the rom sits in the archive, with the size and crc32 the archive stores for it
+struct Member
+{
+  const uint8* data{};
+  size_t size{};
+  size_t romSize{};
+  uint32 crc{};
+  bool deflated{}; //stored otherwise
+};
+//only reads the gzip header and footer or the zip directory, nothing is inflated. zip archives use their first .gb
+//or .gbc entry
+std::optional<Member> locate(const Format format, const uint8* data, const size_t size);
+//replaces rom with the decompressed rom and checks it against the stored crc32
+bool extract(const Member& member, std::vector<uint8>& rom);
+} //namespace RomArchive
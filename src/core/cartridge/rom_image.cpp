@@ -0,0 +1,388 @@
+#include "core/cartridge/rom_image.h"
+#include "core/cartridge/rom_patch.h"
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+constexpr uint16 checksumAddress{0x14E};
+
+struct CacheKey
+{
+  std::string path;
+  uint32 checksum; //global checksum of a plain rom, the stored crc32 of a compressed one
+  auto operator<=>(const CacheKey&) const = default;
+};
+
+struct PatchedKey
+{
+  uint64_t rom;
+  uint64_t patch;
+  auto operator<=>(const PatchedKey&) const = default;
+};
+
+template<typename Key>
+using ImageCache = std::map<Key, std::weak_ptr<const RomImage>>;
+
+std::mutex cacheMutex;
+ImageCache<CacheKey> cache;
+ImageCache<PatchedKey> patchedCache;
+
+//null when the image isn't cached, an entry whose image was destroyed is erased on the way. cacheMutex must be held
+template<typename Key>
+std::shared_ptr<const RomImage> findCached(ImageCache<Key>& images, const Key& key)
+{
+  const auto entry{images.find(key)};
+  if(entry == images.end()) return nullptr;
+  if(auto image{entry->second.lock()}) return image;
+  images.erase(entry);
+  return nullptr;
+}
+
+//also drops the entries of every other destroyed image, so roms loaded once don't stay in the cache forever
+template<typename Key>
+void addCached(ImageCache<Key>& images, const Key& key, const std::shared_ptr<const RomImage>& image)
+{
+  std::erase_if(images, [](const auto& entry) { return entry.second.expired(); });
+  images.emplace(key, image);
+}
+} //namespace
+
+RomImage::RomImage()
+  : m_mapping{}
+  , m_mappingSize{}
+  , m_buffer{}
+  , m_data{}
+  , m_size{}
+{
+}
+
+RomImage::~RomImage()
+{
+#ifndef _WIN32
+  if(m_mapping) munmap(m_mapping, m_mappingSize);
+#endif
+}
+
+std::shared_ptr<const RomImage> RomImage::load(const std::filesystem::path& path)
+{
+  std::error_code error{};
+  CacheKey key{std::filesystem::weakly_canonical(path, error).string(), 0};
+  if(error) key.path = path.string();
+
+  std::shared_ptr<const RomImage> image{};
+  if(const RomArchive::Format format{RomArchive::detect(path)}; format != RomArchive::Format::none)
+  {
+    //archives are looked up by the crc32 they store, so only the first instance inflates the rom
+    const std::shared_ptr<const RomImage> archive{mapFile(path)};
+    if(!archive) return nullptr;
+    const std::optional<RomArchive::Member> member{RomArchive::locate(format, archive->m_data, archive->fileSize())};
+    if(!member) return nullptr;
+    key.checksum = member->crc;
+    {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      if(auto cached{findCached(cache, key)}) return cached;
+    }
+    image = inflate(*member);
+  }
+  else
+  {
+    image = map(path);
+    if(image) key.checksum = image->getChecksum();
+  }
+  if(!image) return nullptr;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if(auto cached{findCached(cache, key)}) return cached; //the new image goes away, it was loaded by another thread too
+  addCached(cache, key, image);
+  return image;
+}
+
+std::shared_ptr<const RomImage> RomImage::load(const std::filesystem::path& path,
+                                               const std::filesystem::path& patchPath)
+{
+  std::shared_ptr<const RomImage> source{load(path)};
+  if(!source || patchPath.empty()) return source;
+
+  std::ifstream patchFile(patchPath, std::ios::binary);
+  if(patchFile.fail())
+  {
+    std::cerr << "Failed to open patch " << patchPath << '\n';
+    return nullptr;
+  }
+  const std::vector<uint8> patchBytes{std::istreambuf_iterator<char>{patchFile}, std::istreambuf_iterator<char>{}};
+
+  const PatchedKey key{hash(source->m_data, source->fileSize()), hash(patchBytes.data(), patchBytes.size())};
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(auto cached{findCached(patchedCache, key)}) return cached;
+  }
+  std::shared_ptr<const RomImage> image{applyPatch(*source, path, patchBytes)};
+  if(!image) return nullptr;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if(auto cached{findCached(patchedCache, key)}) return cached; //patched by another thread in the meantime
+  addCached(patchedCache, key, image);
+  return image;
+}
+
+std::shared_ptr<const RomImage> RomImage::applyPatch(const RomImage& source, const std::filesystem::path& path,
+                                                     const std::vector<uint8>& patch)
+{
+  std::shared_ptr<RomImage> image{new RomImage()};
+  const size_t sourceSize{source.fileSize()};
+  switch(RomPatch::detect(patch))
+  {
+  case RomPatch::Format::ips:
+  {
+    const std::optional<size_t> targetSize{RomPatch::ipsTargetSize(patch, sourceSize)};
+    if(!targetSize)
+    {
+      std::cerr << "Malformed ips patch\n";
+      return nullptr;
+    }
+    uint8* target{};
+#ifndef _WIN32
+    //a private writable mapping of the same file, the kernel copies the pages the patch writes and shares the rest
+    if(source.m_mapping && *targetSize <= sourceSize)
+    {
+      const int file{open(path.c_str(), O_RDONLY)};
+      struct stat fileStat{};
+      if(file >= 0 && fstat(file, &fileStat) == 0 && static_cast<size_t>(fileStat.st_size) == sourceSize)
+      {
+        void* mapping{mmap(nullptr, sourceSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0)};
+        if(mapping != MAP_FAILED)
+        {
+          image->m_mapping = mapping;
+          image->m_mappingSize = sourceSize;
+          target = static_cast<uint8*>(mapping);
+        }
+      }
+      if(file >= 0) close(file);
+    }
+#endif
+    if(!target) //growing patches and hosts without mmap patch a copy
+    {
+      image->m_buffer.assign(source.m_data, source.m_data + std::min(sourceSize, *targetSize));
+      image->m_buffer.resize(*targetSize);
+      target = image->m_buffer.data();
+    }
+    RomPatch::applyIps(patch, target, *targetSize);
+#ifndef _WIN32
+    if(image->m_mapping) mprotect(image->m_mapping, image->m_mappingSize, PROT_READ);
+#endif
+    image->m_data = target;
+    image->m_size = *targetSize;
+    break;
+  }
+  case RomPatch::Format::bps:
+    if(!RomPatch::applyBps(patch, source.m_data, sourceSize, image->m_buffer)) return nullptr;
+    image->m_data = image->m_buffer.data();
+    image->m_size = image->m_buffer.size();
+    break;
+  default: std::cerr << "Unknown patch format\n"; return nullptr;
+  }
+
+  if(!image->validate()) return nullptr;
+  return image;
+}
+
+std::shared_ptr<const RomImage> RomImage::fromBuffer(const uint8* data, size_t size)
+{
+  std::shared_ptr<RomImage> image{new RomImage()};
+  image->m_buffer.assign(data, data + size);
+  image->m_data = image->m_buffer.data();
+  image->m_size = image->m_buffer.size();
+  if(!image->validate()) return nullptr;
+  return image;
+}
+
+const uint8* RomImage::data() const
+{
+  return m_data;
+}
+
+size_t RomImage::size() const
+{
+  return m_size;
+}
+
+uint16 RomImage::getChecksum() const
+{
+  return static_cast<uint16>((m_data[checksumAddress] << 8) | m_data[checksumAddress + 1]);
+}
+
+uint64_t RomImage::hash(const uint8* data, size_t size)
+{
+  //one multiply and rotate per 8 byte word, then the murmur3 finalizer to spread the last words over every bit
+  constexpr uint64_t prime0{0x9E3779B97F4A7C15};
+  constexpr uint64_t prime1{0xC2B2AE3D27D4EB4F};
+  uint64_t hash{size * prime0};
+  size_t offset{};
+  for(; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+  {
+    uint64_t word{};
+    std::memcpy(&word, data + offset, sizeof(word));
+    hash = std::rotl(hash ^ (word * prime1), 31) * prime0;
+  }
+  for(; offset < size; ++offset) hash = std::rotl(hash ^ (data[offset] * prime1), 11) * prime0;
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCD;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+uint32 RomImage::crc32(const uint8* data, size_t size)
+{
+  static const std::array<uint32, 256> table{[]
+  {
+    std::array<uint32, 256> table{};
+    for(uint32 i{}; i < table.size(); ++i)
+    {
+      uint32 value{i};
+      for(int bit{}; bit < 8; ++bit) value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+      table[i] = value;
+    }
+    return table;
+  }()};
+  uint32 crc{0xFFFFFFFF};
+  for(size_t i{}; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+std::shared_ptr<const RomImage> RomImage::map(const std::filesystem::path& path)
+{
+  std::shared_ptr<RomImage> file{mapFile(path)};
+  if(!file) return nullptr;
+
+  if(const RomArchive::Format format{RomArchive::detect(path)}; format != RomArchive::Format::none)
+  {
+    const std::optional<RomArchive::Member> member{RomArchive::locate(format, file->m_data, file->fileSize())};
+    if(!member) return nullptr;
+    return inflate(*member); //the archive mapping is dropped with file once the rom is inflated
+  }
+
+  if(!file->validate()) return nullptr;
+  return file;
+}
+
+std::shared_ptr<RomImage> RomImage::mapFile(const std::filesystem::path& path)
+{
+  std::shared_ptr<RomImage> image{new RomImage()};
+#ifndef _WIN32
+  const int file{open(path.c_str(), O_RDONLY)};
+  if(file < 0)
+  {
+    std::cerr << "Failed to open file\n";
+    return nullptr;
+  }
+
+  struct stat fileStat{};
+  if(fstat(file, &fileStat) == 0 && fileStat.st_size >= headerEnd)
+  {
+    void* mapping{mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, file, 0)};
+    if(mapping != MAP_FAILED)
+    {
+      image->m_mapping = mapping;
+      image->m_mappingSize = fileStat.st_size;
+      image->m_data = static_cast<const uint8*>(mapping);
+      image->m_size = fileStat.st_size;
+    }
+  }
+  close(file);
+#endif
+
+  if(!image->m_mapping) //no mmap, fall back to reading the whole file
+  {
+    std::ifstream rom(path, std::ios::binary | std::ios::ate);
+    if(rom.fail())
+    {
+      std::cerr << "Failed to open file\n";
+      return nullptr;
+    }
+    auto size{rom.tellg()};
+    rom.seekg(0);
+    image->m_buffer.resize(size);
+    rom.read(reinterpret_cast<char*>(image->m_buffer.data()), size);
+    image->m_data = image->m_buffer.data();
+    image->m_size = image->m_buffer.size();
+  }
+
+  return image;
+}
+
+std::shared_ptr<const RomImage> RomImage::inflate(const RomArchive::Member& member)
+{
+  std::shared_ptr<RomImage> image{new RomImage()};
+  if(!RomArchive::extract(member, image->m_buffer)) return nullptr;
+  image->m_data = image->m_buffer.data();
+  image->m_size = image->m_buffer.size();
+  if(!image->validate()) return nullptr;
+  return image;
+}
+
+size_t RomImage::fileSize() const
+{
+  return m_mapping ? m_mappingSize : m_buffer.size();
+}
+
+size_t RomImage::declaredSize(const uint8* header)
+{
+  constexpr uint16 romSizeAddress{0x148};
+  constexpr size_t kb16{0x4000};
+  const uint8 romSize{header[romSizeAddress]};
+  if(romSize <= 0x8) return (2 * kb16) << romSize;
+  else if(romSize == 0x52) return 72 * kb16;
+  else if(romSize == 0x53) return 80 * kb16;
+  else if(romSize == 0x54) return 96 * kb16;
+  return 0;
+}
+
+bool RomImage::validate()
+{
+  if(m_size < headerEnd)
+  {
+    std::cerr << "Rom is too small to contain a header\n";
+    return false;
+  }
+
+  //the same check the boot rom does before starting the game
+  constexpr uint16 titleAddress{0x134};
+  constexpr uint16 headerChecksumAddress{0x14D};
+  uint8 headerChecksum{};
+  for(uint16 addr{titleAddress}; addr < headerChecksumAddress; ++addr) headerChecksum -= m_data[addr] + 1;
+  if(headerChecksum != m_data[headerChecksumAddress])
+  {
+    std::cerr << "Rom header checksum doesn't match\n";
+    return false;
+  }
+
+  //the mbcs index banks up to the declared size, so a shorter file can't be used
+  const size_t expectedSize{declaredSize(m_data)};
+  if(expectedSize == 0)
+  {
+    std::cerr << "Unknown rom size in the header\n";
+    return false;
+  }
+  if(m_size < expectedSize)
+  {
+    std::cerr << "Rom is smaller than its header declares\n";
+    return false;
+  }
+  m_size = expectedSize;
+  return true;
+}
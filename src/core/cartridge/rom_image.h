@@ -0,0 +1,54 @@
+#pragma once
+#include "core/cartridge/rom_archive.h"
+#include "type_alias.h"
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+//read-only rom bytes shared by every cartridge loaded from the same file.
+//on posix the file is mapped instead of copied so the kernel shares the pages between instances too. every image has a
+//valid header: the header checksum matches and the file holds at least as many bytes as the rom size byte declares
+class RomImage
+{
+public:
+  ~RomImage();
+
+  //the file is opened and mapped once, then the cached image is returned if the same file with the same checksum is
+  //already loaded. compressed files are only inflated when the crc32 they store isn't cached yet. null on failure
+  static std::shared_ptr<const RomImage> load(const std::filesystem::path& path);
+  //the rom with an ips or bps patch applied, cached per rom and patch content so every instance shares one patched
+  //image. ips patches that fit in the file patch a private mapping of it, so only the pages they touch get copied
+  static std::shared_ptr<const RomImage> load(const std::filesystem::path& path, const std::filesystem::path& patchPath);
+  static std::shared_ptr<const RomImage> fromBuffer(const uint8* data, size_t size); //copies, not cached
+  //not cached, for one-off reads. .gz and .zip files are inflated into a buffer from a mapping of the archive
+  static std::shared_ptr<const RomImage> map(const std::filesystem::path& path);
+
+  //fast 64 bit content hash to tell roms apart, not cryptographic
+  static uint64_t hash(const uint8* data, size_t size);
+  static uint32 crc32(const uint8* data, size_t size); //as stored by bps patches and compressed files
+
+  const uint8* data() const;
+  size_t size() const; //as declared by the header, bytes past it are ignored
+  uint16 getChecksum() const; //global checksum from the header
+
+  static constexpr uint16 headerEnd{0x150};
+
+private:
+  RomImage();
+  RomImage(const RomImage&) = delete;
+  RomImage& operator=(const RomImage&) = delete;
+
+  static std::shared_ptr<RomImage> mapFile(const std::filesystem::path& path); //the raw file, not validated
+  static std::shared_ptr<const RomImage> inflate(const RomArchive::Member& member);
+  static std::shared_ptr<const RomImage> applyPatch(const RomImage& source, const std::filesystem::path& path,
+                                                    const std::vector<uint8>& patch);
+  size_t fileSize() const; //before validate cut it to the declared size
+  static size_t declaredSize(const uint8* header); //rom size according to byte 0x148, 0 for unknown values
+  bool validate();
+
+  void* m_mapping; //null when the bytes live in m_buffer
+  size_t m_mappingSize;
+  std::vector<uint8> m_buffer;
+  const uint8* m_data;
+  size_t m_size;
+};
@@ -0,0 +1,219 @@
+#include "core/cartridge/rom_patch.h"
+#include "core/cartridge/rom_image.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+constexpr std::string_view ipsMagic{"PATCH"};
+constexpr std::string_view ipsEnd{"EOF"};
+constexpr std::string_view bpsMagic{"BPS1"};
+
+bool startsWith(const std::vector<uint8>& patch, const std::string_view magic)
+{
+  return patch.size() >= magic.size() && std::memcmp(patch.data(), magic.data(), magic.size()) == 0;
+}
+
+uint32 readBigEndian(const uint8* bytes, const int size)
+{
+  uint32 value{};
+  for(int i{}; i < size; ++i) value = value << 8 | bytes[i];
+  return value;
+}
+
+//calls record(offset, size, data, rleValue) for every ips record, data is null for run length records. returns the
+//truncated size if the patch ends with one, 0 if not and nullopt if it's malformed
+template<typename Record>
+std::optional<size_t> readIps(const std::vector<uint8>& patch, Record record)
+{
+  size_t position{ipsMagic.size()};
+  while(true)
+  {
+    if(position + 3 > patch.size()) return std::nullopt;
+    if(std::memcmp(patch.data() + position, ipsEnd.data(), ipsEnd.size()) == 0)
+    {
+      position += 3;
+      if(position + 3 <= patch.size()) return readBigEndian(patch.data() + position, 3);
+      return 0;
+    }
+    const size_t offset{readBigEndian(patch.data() + position, 3)};
+    if(position + 5 > patch.size()) return std::nullopt;
+    size_t size{readBigEndian(patch.data() + position + 3, 2)};
+    position += 5;
+    if(size) //literal bytes
+    {
+      if(position + size > patch.size()) return std::nullopt;
+      record(offset, size, patch.data() + position, uint8{});
+      position += size;
+    }
+    else //run of a single value
+    {
+      if(position + 3 > patch.size()) return std::nullopt;
+      size = readBigEndian(patch.data() + position, 2);
+      record(offset, size, static_cast<const uint8*>(nullptr), patch[position + 2]);
+      position += 3;
+    }
+  }
+}
+} //namespace
+
+RomPatch::Format RomPatch::detect(const std::vector<uint8>& patch)
+{
+  if(startsWith(patch, ipsMagic)) return Format::ips;
+  if(startsWith(patch, bpsMagic)) return Format::bps;
+  return Format::unknown;
+}
+
+std::optional<size_t> RomPatch::ipsTargetSize(const std::vector<uint8>& patch, const size_t sourceSize)
+{
+  size_t targetSize{sourceSize};
+  const std::optional<size_t> truncated{readIps(patch, [&targetSize](size_t offset, size_t size, const uint8*, uint8)
+                                                { targetSize = std::max(targetSize, offset + size); })};
+  if(!truncated) return std::nullopt;
+  return *truncated ? *truncated : targetSize;
+}
+
+bool RomPatch::applyIps(const std::vector<uint8>& patch, uint8* target, const size_t targetSize)
+{
+  return readIps(patch,
+                 [target, targetSize](size_t offset, size_t size, const uint8* data, uint8 value)
+                 {
+                   //records past a truncation are dropped with it
+                   if(offset >= targetSize) return;
+                   size = std::min(size, targetSize - offset);
+                   if(data) std::memcpy(target + offset, data, size);
+                   else std::memset(target + offset, value, size);
+                 })
+    .has_value();
+}
+
+bool RomPatch::applyBps(const std::vector<uint8>& patch, const uint8* source, const size_t sourceSize,
+                        std::vector<uint8>& target)
+{
+  constexpr size_t footerSize{12}; //source, target and patch crc32
+  if(!startsWith(patch, bpsMagic) || patch.size() < bpsMagic.size() + footerSize)
+  {
+    std::cerr << "Malformed bps patch\n";
+    return false;
+  }
+  const size_t actionsEnd{patch.size() - footerSize};
+  size_t position{bpsMagic.size()};
+  bool malformed{};
+  auto readNumber{[&]() -> uint64_t
+  {
+    uint64_t value{};
+    uint64_t shift{1};
+    while(!malformed)
+    {
+      if(position >= actionsEnd || shift > (uint64_t{1} << 56))
+      {
+        malformed = true;
+        break;
+      }
+      const uint8 byte{patch[position++]};
+      value += (byte & 0x7F) * shift;
+      if(byte & 0x80) break;
+      shift <<= 7;
+      value += shift;
+    }
+    return value;
+  }};
+
+  auto readCrc{[&patch](size_t offset)
+  {
+    uint32 value{};
+    for(int i{3}; i >= 0; --i) value = value << 8 | patch[offset + i];
+    return value;
+  }};
+  if(RomImage::crc32(patch.data(), patch.size() - 4) != readCrc(patch.size() - 4))
+  {
+    std::cerr << "Bps patch checksum doesn't match\n";
+    return false;
+  }
+  if(RomImage::crc32(source, sourceSize) != readCrc(actionsEnd))
+  {
+    std::cerr << "Bps patch is for a different rom\n";
+    return false;
+  }
+
+  const uint64_t expectedSourceSize{readNumber()};
+  const uint64_t targetSize{readNumber()};
+  const uint64_t metadataSize{readNumber()};
+  constexpr uint64_t maxTargetSize{8 << 20}; //the largest rom size code
+  if(malformed || expectedSourceSize != sourceSize || targetSize > maxTargetSize || metadataSize > actionsEnd - position)
+  {
+    std::cerr << "Malformed bps patch\n";
+    return false;
+  }
+  position += metadataSize;
+
+  enum Action
+  {
+    sourceRead,
+    targetRead,
+    sourceCopy,
+    targetCopy,
+  };
+  target.assign(targetSize, 0);
+  size_t output{};
+  int64_t sourceOffset{};
+  int64_t targetOffset{};
+  while(!malformed && position < actionsEnd)
+  {
+    const uint64_t data{readNumber()};
+    const uint64_t length{(data >> 2) + 1};
+    if(length > targetSize - output)
+    {
+      malformed = true;
+      break;
+    }
+    switch(data & 3)
+    {
+    case sourceRead:
+      if(output + length > sourceSize) malformed = true;
+      else std::memcpy(target.data() + output, source + output, length);
+      break;
+    case targetRead:
+      if(length > actionsEnd - position) malformed = true;
+      else
+      {
+        std::memcpy(target.data() + output, patch.data() + position, length);
+        position += length;
+      }
+      break;
+    case sourceCopy:
+    case targetCopy:
+    {
+      const uint64_t offset{readNumber()};
+      const int64_t delta{static_cast<int64_t>(offset >> 1) * (offset & 1 ? -1 : 1)};
+      const bool fromSource{(data & 3) == sourceCopy};
+      int64_t& relative{fromSource ? sourceOffset : targetOffset};
+      relative += delta;
+      const uint64_t limit{fromSource ? sourceSize : output}; //a target copy can repeat the bytes it is writing
+      if(relative < 0 || static_cast<uint64_t>(relative) >= limit ||
+         (fromSource && static_cast<uint64_t>(relative) + length > sourceSize))
+      {
+        malformed = true;
+        break;
+      }
+      const uint8* from{fromSource ? source : target.data()};
+      for(uint64_t i{}; i < length; ++i) target[output + i] = from[relative++];
+      break;
+    }
+    }
+    output += length;
+  }
+  if(malformed || output != targetSize)
+  {
+    std::cerr << "Malformed bps patch\n";
+    return false;
+  }
+  if(RomImage::crc32(target.data(), target.size()) != readCrc(actionsEnd + 4))
+  {
+    std::cerr << "Bps patch produced the wrong rom\n";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "type_alias.h"
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+//ips and bps rom patches, RomImage::load applies them and caches the result
+namespace RomPatch
+{
+enum class Format
+{
+  unknown,
+  ips,
+  bps,
+};
+Format detect(const std::vector<uint8>& patch);
+
+//size of the patched rom, nullopt if the patch is malformed. ips patches may grow the rom or, with the truncation
+//extension, shrink it
+std::optional<size_t> ipsTargetSize(const std::vector<uint8>& patch, const size_t sourceSize);
+//target holds the source bytes and is at least the target size, an ips patch only writes the bytes it changes
+bool applyIps(const std::vector<uint8>& patch, uint8* target, const size_t targetSize);
+
+//bps patches describe the whole target, the source, target and patch checksums are verified
+bool applyBps(const std::vector<uint8>& patch, const uint8* source, const size_t sourceSize, std::vector<uint8>& target);
+} //namespace RomPatch
@@ -0,0 +1,153 @@
+#include "core/cartridge/rtc.h"
+#include "core/save_state.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+constexpr uint64_t secondsPerDay{24 * 60 * 60};
+constexpr uint32 dayCount{512}; //the day counter has 9 bits
+
+uint32 readLittleEndian(const uint8* bytes, const int size)
+{
+  uint32 value{};
+  for(int i{size - 1}; i >= 0; --i) value = value << 8 | bytes[i];
+  return value;
+}
+
+void writeLittleEndian(uint8* bytes, uint64_t value, const int size)
+{
+  for(int i{}; i < size; ++i, value >>= 8) bytes[i] = static_cast<uint8>(value);
+}
+} //namespace
+
+Rtc::Rtc(const uint64_t* emulatedClock)
+  : m_emulatedClock{emulatedClock}
+  , m_registers{}
+  , m_latched{0xFF, 0xFF, 0xFF, 0xFF, 0xFF}
+  , m_timestamp{now()}
+{
+}
+
+uint64_t Rtc::now() const
+{
+  if(m_emulatedClock) return *m_emulatedClock;
+  const auto sinceEpoch{std::chrono::system_clock::now().time_since_epoch()};
+  const auto wholeSeconds{std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch)};
+  const auto microseconds{std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch - wholeSeconds)};
+  return static_cast<uint64_t>(wholeSeconds.count()) << secondShift |
+         (static_cast<uint64_t>(microseconds.count()) << secondShift) / 1'000'000;
+}
+
+void Rtc::update()
+{
+  const uint64_t time{now()};
+  if(time < m_timestamp || m_registers[daysHigh] & haltBit)
+  {
+    m_timestamp = time; //halted, or the host clock went back
+    return;
+  }
+  const uint64_t elapsedSeconds{(time - m_timestamp) >> secondShift};
+  m_timestamp += elapsedSeconds << secondShift; //the started second carries over
+  advance(elapsedSeconds);
+}
+
+void Rtc::advance(uint64_t elapsedSeconds)
+{
+  //values a game wrote out of range tick one by one until they wrap back into range
+  for(; elapsedSeconds && (m_registers[seconds] >= 60 || m_registers[minutes] >= 60 || m_registers[hours] >= 24);
+      --elapsedSeconds)
+    tick();
+  if(!elapsedSeconds) return;
+
+  uint64_t days{static_cast<uint64_t>(m_registers[daysHigh] & 1) << 8 | m_registers[daysLow]};
+  uint64_t time{m_registers[seconds] + m_registers[minutes] * 60u + m_registers[hours] * 3600u + elapsedSeconds};
+  days += time / secondsPerDay;
+  time %= secondsPerDay;
+  m_registers[seconds] = static_cast<uint8>(time % 60);
+  m_registers[minutes] = static_cast<uint8>(time / 60 % 60);
+  m_registers[hours] = static_cast<uint8>(time / 3600);
+  if(days >= dayCount) m_registers[daysHigh] |= daysCarryBit;
+  days %= dayCount;
+  m_registers[daysLow] = static_cast<uint8>(days);
+  m_registers[daysHigh] = static_cast<uint8>((m_registers[daysHigh] & ~1) | days >> 8);
+}
+
+void Rtc::tick()
+{
+  //a counter only carries when it reaches its limit, out of range values wrap at their bit width instead
+  m_registers[seconds] = (m_registers[seconds] + 1) & bitmasks[seconds];
+  if(m_registers[seconds] != 60) return;
+  m_registers[seconds] = 0;
+  m_registers[minutes] = (m_registers[minutes] + 1) & bitmasks[minutes];
+  if(m_registers[minutes] != 60) return;
+  m_registers[minutes] = 0;
+  m_registers[hours] = (m_registers[hours] + 1) & bitmasks[hours];
+  if(m_registers[hours] != 24) return;
+  m_registers[hours] = 0;
+  if(++m_registers[daysLow] != 0) return;
+  if(m_registers[daysHigh] & 1) //the 9 bit day counter overflows
+  {
+    m_registers[daysHigh] &= ~1;
+    m_registers[daysHigh] |= daysCarryBit;
+  }
+  else m_registers[daysHigh] |= 1;
+}
+
+void Rtc::latch()
+{
+  update();
+  m_latched = m_registers;
+}
+
+uint8 Rtc::read(const Register reg) const
+{
+  return m_latched[reg] | ~bitmasks[reg];
+}
+
+void Rtc::write(const Register reg, const uint8 value)
+{
+  update();
+  const uint8 maskedValue{static_cast<uint8>(value & bitmasks[reg])};
+  m_registers[reg] = maskedValue;
+  m_latched[reg] = maskedValue;
+  if(reg == seconds) m_timestamp = now(); //writing the seconds restarts the current second
+}
+
+void Rtc::saveFooter(uint8* footer) const
+{
+  for(int i{}; i < registerCount; ++i)
+  {
+    writeLittleEndian(footer + i * 4, m_registers[i], 4);
+    writeLittleEndian(footer + (registerCount + i) * 4, m_latched[i], 4);
+  }
+  writeLittleEndian(footer + registerCount * 8, m_timestamp >> secondShift, 8);
+}
+
+void Rtc::loadFooter(const uint8* footer)
+{
+  if(std::all_of(footer, footer + footerSize, [](uint8 byte) { return byte == 0; })) return;
+  for(int i{}; i < registerCount; ++i)
+  {
+    m_registers[i] = static_cast<uint8>(readLittleEndian(footer + i * 4, 4) & bitmasks[i]);
+    m_latched[i] = static_cast<uint8>(readLittleEndian(footer + (registerCount + i) * 4, 4) & bitmasks[i]);
+  }
+  const uint64_t unixTime{readLittleEndian(footer + registerCount * 8, 4) |
+                          static_cast<uint64_t>(readLittleEndian(footer + registerCount * 8 + 4, 4)) << 32};
+  //with the emulated clock the time in the footer means nothing, the clock just continues from the registers
+  if(!m_emulatedClock) m_timestamp = std::min(unixTime << secondShift, now());
+}
+
+void Rtc::saveState(StateWriter& state) const
+{
+  state.write(m_registers);
+  state.write(m_latched);
+  state.write(m_timestamp);
+}
+
+void Rtc::loadState(StateReader& state)
+{
+  state.read(m_registers);
+  state.read(m_latched);
+  state.read(m_timestamp);
+}
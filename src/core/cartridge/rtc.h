@@ -0,0 +1,57 @@
+#pragma once
+#include "type_alias.h"
+#include <array>
+#include <cstddef>
+
+class StateWriter;
+class StateReader;
+
+//mbc3 real time clock. it isn't ticked, the registers hold the time at m_timestamp and are brought up to date when the
+//game latches or writes them. timestamps count m-cycles: the emulated clock in deterministic mode, the host's unix
+//time otherwise, so the clock keeps running while the emulator is closed
+class Rtc
+{
+public:
+  enum Register
+  {
+    seconds,
+    minutes,
+    hours,
+    daysLow,
+    daysHigh,
+    registerCount,
+  };
+
+  explicit Rtc(const uint64_t* emulatedClock); //null for the host's clock
+
+  void latch();
+  uint8 read(const Register reg) const; //the latched value
+  void write(const Register reg, const uint8 value);
+
+  //the footer emulators append to the .sav: the current and the latched registers as 32 bit values and the unix time
+  //they were current at as 64 bit value, all little endian. the older 44 byte form with a 32 bit time reads the same
+  //once the file is zero extended
+  static constexpr size_t footerSize{48};
+  void saveFooter(uint8* footer) const;
+  void loadFooter(const uint8* footer); //a zeroed footer, from a save without one, starts the clock at zero
+
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
+private:
+  static constexpr int secondShift{20}; //m-cycles per second as a power of two
+  static constexpr std::array<uint8, registerCount> bitmasks{0b0011'1111, 0b0011'1111, 0b0001'1111, 0b1111'1111,
+                                                             0b1100'0001};
+  static constexpr uint8 haltBit{0b0100'0000};
+  static constexpr uint8 daysCarryBit{0b1000'0000};
+
+  uint64_t now() const;
+  void update();
+  void advance(uint64_t elapsedSeconds);
+  void tick(); //one second, with the wrap around of out of range values
+
+  const uint64_t* m_emulatedClock;
+  std::array<uint8, registerCount> m_registers;
+  std::array<uint8, registerCount> m_latched;
+  uint64_t m_timestamp; //time the registers hold, whole seconds behind now at most
+};
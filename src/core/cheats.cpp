@@ -0,0 +1,67 @@
+#include "core/cheats.h"
+#include "memory_regions.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace
+{
+//the hex digits of the code without dashes, nullopt if it has other characters or the wrong length
+template<size_t count>
+std::optional<std::array<uint8, count>> readDigits(std::string_view code)
+{
+  std::array<uint8, count> digits{};
+  size_t digit{};
+  for(const char character : code)
+  {
+    if(character == '-') continue;
+    if(digit == count) return std::nullopt;
+    if(character >= '0' && character <= '9') digits[digit++] = character - '0';
+    else if(character >= 'a' && character <= 'f') digits[digit++] = character - 'a' + 10;
+    else if(character >= 'A' && character <= 'F') digits[digit++] = character - 'A' + 10;
+    else return std::nullopt;
+  }
+  if(digit != count) return std::nullopt;
+  return digits;
+}
+} //namespace
+
+std::optional<RomCheat> Cheats::parseGameGenie(std::string_view code)
+{
+  std::array<uint8, 9> d{};
+  bool hasCompare{true};
+  if(const std::optional<std::array<uint8, 9>> digits{readDigits<9>(code)}) d = *digits;
+  else if(const std::optional<std::array<uint8, 6>> digits{readDigits<6>(code)})
+  {
+    std::copy(digits->begin(), digits->end(), d.begin());
+    hasCompare = false;
+  }
+  else return std::nullopt;
+
+  //ABC-DEF-GHI: AB is the new value, FCDE the address with F inverted, GI the rotated and scrambled compare value
+  RomCheat cheat{};
+  cheat.value = static_cast<uint8>(d[0] << 4 | d[1]);
+  cheat.address = static_cast<uint16>(((d[5] ^ 0xF) << 12) | d[2] << 8 | d[3] << 4 | d[4]);
+  if(cheat.address > MemoryRegions::romBank1.second) return std::nullopt;
+  if(hasCompare) cheat.compare = std::rotr(static_cast<uint8>(d[6] << 4 | d[8]), 2) ^ 0xBA;
+  return cheat;
+}
+
+std::optional<RamCheat> Cheats::parseGameShark(std::string_view code)
+{
+  const std::optional<std::array<uint8, 8>> digits{readDigits<8>(code)};
+  if(!digits) return std::nullopt;
+  const std::array<uint8, 8>& d{*digits};
+
+  const uint8 type{static_cast<uint8>(d[0] << 4 | d[1])};
+  const bool bankType{((type & 0xF0) == 0x80 || (type & 0xF0) == 0x90) && (type & 0xF) <= 0x7};
+  if(type > 0x01 && !bankType) return std::nullopt;
+  const RamCheat cheat{static_cast<uint16>(d[6] << 12 | d[7] << 8 | d[4] << 4 | d[5]), static_cast<uint8>(d[2] << 4 | d[3])};
+
+  //the code is written through the bus every frame, anywhere else it would hit mbc or io registers
+  using namespace MemoryRegions;
+  const bool inRam{(cheat.address >= externalRam.first && cheat.address <= workRam1.second) ||
+                   (cheat.address >= highRam.first && cheat.address <= highRam.second)};
+  if(!inRam) return std::nullopt;
+  return cheat;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "type_alias.h"
+#include <optional>
+#include <string_view>
+
+//game genie codes replace a rom byte as the cpu sees it, optionally only while the original byte matches
+struct RomCheat
+{
+  uint16 address{};
+  uint8 value{};
+  std::optional<uint8> compare{};
+};
+
+//gameshark codes write a byte every frame
+struct RamCheat
+{
+  uint16 address{};
+  uint8 value{};
+};
+
+namespace Cheats
+{
+//ABC-DEF or ABC-DEF-GHI, the dashes are optional
+std::optional<RomCheat> parseGameGenie(std::string_view code);
+//TTVVLLHH: type, value and the address low byte first. types 00, 01 and the cgb wram bank types 8x/9x are accepted,
+//the bank is ignored since the dmg has a single one. only external ram, wram and hram addresses are accepted
+std::optional<RamCheat> parseGameShark(std::string_view code);
+} //namespace Cheats
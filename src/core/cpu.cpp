@@ -1,8 +1,118 @@
 #include "core/cpu.h"
 #include "core/mmu.h"
+#include "core/save_state.h"
 #include "hardware_registers.h"
+#include <algorithm>
 #include <iostream>
 
+const std::array<CPU::InstructionHandler, 105> CPU::instructionHandlers{
+  nullptr,
+  &CPU::interruptRoutine,
+  &CPU::LD_r_r2,
+  &CPU::LD_r_n,
+  &CPU::LD_r_HL,
+  &CPU::LD_HL_r,
+  &CPU::LD_HL_n,
+  &CPU::LD_A_BC,
+  &CPU::LD_A_DE,
+  &CPU::LD_BC_A,
+  &CPU::LD_DE_A,
+  &CPU::LD_A_nn,
+  &CPU::LD_nn_A,
+  &CPU::LDH_A_C,
+  &CPU::LDH_C_A,
+  &CPU::LDH_A_n,
+  &CPU::LDH_n_A,
+  &CPU::LD_A_HLd,
+  &CPU::LD_HLd_A,
+  &CPU::LD_A_HLi,
+  &CPU::LD_HLi_A,
+  &CPU::LD_rr_nn,
+  &CPU::LD_nn_SP,
+  &CPU::LD_SP_HL,
+  &CPU::PUSH_rr,
+  &CPU::POP_rr,
+  &CPU::LD_HL_SP_e,
+  &CPU::ADD_r,
+  &CPU::ADD_HL,
+  &CPU::ADD_n,
+  &CPU::ADC_r,
+  &CPU::ADC_HL,
+  &CPU::ADC_n,
+  &CPU::SUB_r,
+  &CPU::SUB_HL,
+  &CPU::SUB_n,
+  &CPU::SBC_r,
+  &CPU::SBC_HL,
+  &CPU::SBC_n,
+  &CPU::CP_r,
+  &CPU::CP_HL,
+  &CPU::CP_n,
+  &CPU::INC_r,
+  &CPU::INC_HL,
+  &CPU::DEC_r,
+  &CPU::DEC_HL,
+  &CPU::AND_r,
+  &CPU::AND_HL,
+  &CPU::AND_n,
+  &CPU::OR_r,
+  &CPU::OR_HL,
+  &CPU::OR_n,
+  &CPU::XOR_r,
+  &CPU::XOR_HL,
+  &CPU::XOR_n,
+  &CPU::DAA,
+  &CPU::CPL,
+  &CPU::CCF,
+  &CPU::SCF,
+  &CPU::INC_rr,
+  &CPU::DEC_rr,
+  &CPU::ADD_HL_rr,
+  &CPU::ADD_SP_e,
+  &CPU::RLCA,
+  &CPU::RRCA,
+  &CPU::RLA,
+  &CPU::RRA,
+  &CPU::RLC_r,
+  &CPU::RLC_HL,
+  &CPU::RRC_r,
+  &CPU::RRC_HL,
+  &CPU::RL_r,
+  &CPU::RL_HL,
+  &CPU::RR_r,
+  &CPU::RR_HL,
+  &CPU::SLA_r,
+  &CPU::SLA_HL,
+  &CPU::SRA_r,
+  &CPU::SRA_HL,
+  &CPU::SWAP_r,
+  &CPU::SWAP_HL,
+  &CPU::SRL_r,
+  &CPU::SRL_HL,
+  &CPU::BIT_b_r,
+  &CPU::BIT_b_HL,
+  &CPU::RES_b_r,
+  &CPU::RES_b_HL,
+  &CPU::SET_b_r,
+  &CPU::SET_b_HL,
+  &CPU::JP_nn,
+  &CPU::JP_HL,
+  &CPU::JP_cc_nn,
+  &CPU::JR_e,
+  &CPU::JR_cc_e,
+  &CPU::CALL_nn,
+  &CPU::CALL_cc_nn,
+  &CPU::RET,
+  &CPU::RET_cc,
+  &CPU::RETI,
+  &CPU::RST_n,
+  &CPU::HALT,
+  &CPU::STOP,
+  &CPU::DI,
+  &CPU::EI,
+  &CPU::NOP,
+};
+
 CPU::CPU(MMU& mmu)
   : m_bus{mmu}
   , m_iState{}
@@ -45,6 +155,53 @@ void CPU::reset()
   m_registers[a] = 0x01;
 }
 
+void CPU::saveState(StateWriter& state) const
+{
+  state.write(m_iState.x);
+  state.write(m_iState.y);
+  state.write(m_iState.z);
+  state.write(m_iState.xx);
+  state.write(m_iState.e);
+  const auto handler{std::find(instructionHandlers.begin(), instructionHandlers.end(), m_currentInstr)};
+  state.write(static_cast<uint8>(handler - instructionHandlers.begin()));
+  state.write(m_cycleCounter);
+  state.write(m_ime);
+  state.write(m_imeEnableNextCycle);
+  state.write(m_halted);
+  state.write(m_haltBug);
+  state.write(m_pendingInterrupts);
+  state.write(m_interruptIndex);
+  state.write(m_pc);
+  state.write(m_sp);
+  state.write(m_registers);
+  state.write(m_f);
+  state.write(m_ir);
+}
+
+void CPU::loadState(StateReader& state)
+{
+  state.read(m_iState.x);
+  state.read(m_iState.y);
+  state.read(m_iState.z);
+  state.read(m_iState.xx);
+  state.read(m_iState.e);
+  uint8 handlerIndex{};
+  state.read(handlerIndex);
+  m_currentInstr = handlerIndex < instructionHandlers.size() ? instructionHandlers[handlerIndex] : nullptr;
+  state.read(m_cycleCounter);
+  state.read(m_ime);
+  state.read(m_imeEnableNextCycle);
+  state.read(m_halted);
+  state.read(m_haltBug);
+  state.read(m_pendingInterrupts);
+  state.read(m_interruptIndex);
+  state.read(m_pc);
+  state.read(m_sp);
+  state.read(m_registers);
+  state.read(m_f);
+  state.read(m_ir);
+}
+
 void CPU::mCycle()
 {
   ++m_cycleCounter; //since instructions reset m_cycleCounter to 0 increment before the cpu cycle so its 1, then if the
@@ -70,10 +227,16 @@ void CPU::mCycle()
   }
 }
 
+CPU::Registers CPU::getRegisters() const
+{
+  return Registers{m_registers[a], m_f, m_registers[b], m_registers[c], m_registers[d], m_registers[e], m_registers[h],
+                   m_registers[l], m_sp, m_pc, m_ime, m_halted};
+}
+
 void CPU::handleInterrupts()
 {
   m_pendingInterrupts =
-    (m_bus.read(hardwareReg::IF, MMU::Component::cpu) & m_bus.read(hardwareReg::IE, MMU::Component::cpu)) &
+    (m_bus.read<MMU::Component::cpu>(hardwareReg::IF) & m_bus.read<MMU::Component::cpu>(hardwareReg::IE)) &
     0b1'1111; //only bits 0-4 are used
   if(!m_pendingInterrupts) return;
 
@@ -100,7 +263,7 @@ void CPU::interruptRoutine()
   case 1: m_currentInstr = &CPU::interruptRoutine; break;
   case 2: break;
   case 3:
-    m_bus.write(--m_sp, getMsb(m_pc), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(--m_sp, getMsb(m_pc));
     //here if the interrupt currently dispatching gets disabled it checks if
     //there's another one to continue the dispatching with and if not it cancels the dispatching
     if(m_sp == hardwareReg::IE && !(getMsb(m_pc) & (1 << m_interruptIndex)))
@@ -122,9 +285,9 @@ void CPU::interruptRoutine()
       }
     }
     break;
-  case 4: m_bus.write(--m_sp, getLsb(m_pc), MMU::Component::cpu); break;
+  case 4: m_bus.write<MMU::Component::cpu>(--m_sp, getLsb(m_pc)); break;
   case 5:
-    m_bus.write(hardwareReg::IF, m_pendingInterrupts & ~(1 << m_interruptIndex), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(hardwareReg::IF, m_pendingInterrupts & ~(1 << m_interruptIndex));
     m_pc = interruptHandlerAddress[m_interruptIndex];
     endInstruction();
 
@@ -134,7 +297,7 @@ void CPU::interruptRoutine()
 
 void CPU::fetch()
 {
-  m_ir = m_bus.read(m_pc++, MMU::Component::cpu);
+  m_ir = m_bus.fetch(m_pc++);
   //std::cout << std::hex << (int)m_ir << '\n';
   if(m_haltBug)
   {
@@ -859,7 +1022,7 @@ void CPU::LD_r_n()
     m_iState.x = (m_ir >> 3) & 0b111; //r
     break;
   case 2:
-    m_iState.y = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.y = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     m_registers[m_iState.x] = m_iState.y;
     endInstruction();
     break;
@@ -875,7 +1038,7 @@ void CPU::LD_r_HL()
     m_iState.x = (m_ir >> 3) & 0b111; //r
     break;
   case 2:
-    m_registers[m_iState.x] = m_bus.read(getHl(), MMU::Component::cpu);
+    m_registers[m_iState.x] = m_bus.read<MMU::Component::cpu>(getHl());
     endInstruction();
     break;
   }
@@ -888,7 +1051,7 @@ void CPU::LD_HL_r()
   case 1: m_currentInstr = &CPU::LD_HL_r; break;
   case 2:
     m_iState.x = m_ir & 0b111; //r
-    m_bus.write(getHl(), m_registers[m_iState.x], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_registers[m_iState.x]);
     endInstruction();
     break;
   }
@@ -900,10 +1063,10 @@ void CPU::LD_HL_n()
   {
   case 1: m_currentInstr = &CPU::LD_HL_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     break;
   case 3:
-    m_bus.write(getHl(), m_iState.x, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.x);
     endInstruction();
     break;
   }
@@ -915,7 +1078,7 @@ void CPU::LD_A_BC()
   {
   case 1: m_currentInstr = &CPU::LD_A_BC; break;
   case 2:
-    m_registers[a] = m_bus.read(getBc(), MMU::Component::cpu);
+    m_registers[a] = m_bus.read<MMU::Component::cpu>(getBc());
     endInstruction();
     break;
   }
@@ -927,7 +1090,7 @@ void CPU::LD_A_DE()
   {
   case 1: m_currentInstr = &CPU::LD_A_DE; break;
   case 2:
-    m_registers[a] = m_bus.read(getDe(), MMU::Component::cpu);
+    m_registers[a] = m_bus.read<MMU::Component::cpu>(getDe());
     endInstruction();
     break;
   }
@@ -939,7 +1102,7 @@ void CPU::LD_BC_A()
   {
   case 1: m_currentInstr = &CPU::LD_BC_A; break;
   case 2:
-    m_bus.write(getBc(), m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getBc(), m_registers[a]);
     endInstruction();
     break;
   }
@@ -951,7 +1114,7 @@ void CPU::LD_DE_A()
   {
   case 1: m_currentInstr = &CPU::LD_DE_A; break;
   case 2:
-    m_bus.write(getDe(), m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getDe(), m_registers[a]);
     endInstruction();
     break;
   }
@@ -962,12 +1125,12 @@ void CPU::LD_A_nn()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::LD_A_nn; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     break;
   case 4:
-    m_registers[a] = m_bus.read(m_iState.xx, MMU::Component::cpu);
+    m_registers[a] = m_bus.read<MMU::Component::cpu>(m_iState.xx);
     endInstruction();
     break;
   }
@@ -978,12 +1141,12 @@ void CPU::LD_nn_A()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::LD_nn_A; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     break;
   case 4:
-    m_bus.write(m_iState.xx, m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(m_iState.xx, m_registers[a]);
     endInstruction();
     break;
   }
@@ -996,7 +1159,7 @@ void CPU::LDH_A_C()
   case 1: m_currentInstr = &CPU::LDH_A_C; break;
   case 2:
     m_registers[a] =
-      m_bus.read(0xFF00 | m_registers[c], MMU::Component::cpu); //xx is 0xFF00 as the high byte + C as the low byte
+      m_bus.read<MMU::Component::cpu>(0xFF00 | m_registers[c]); //xx is 0xFF00 as the high byte + C as the low byte
     endInstruction();
     break;
   }
@@ -1008,7 +1171,7 @@ void CPU::LDH_C_A()
   {
   case 1: m_currentInstr = &CPU::LDH_C_A; break;
   case 2:
-    m_bus.write(0xFF00 | m_registers[c], m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(0xFF00 | m_registers[c], m_registers[a]);
     endInstruction();
     break;
   }
@@ -1020,10 +1183,10 @@ void CPU::LDH_A_n()
   {
   case 1: m_currentInstr = &CPU::LDH_A_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     break;
   case 3:
-    m_registers[a] = m_bus.read(0xFF00 | m_iState.x, MMU::Component::cpu);
+    m_registers[a] = m_bus.read<MMU::Component::cpu>(0xFF00 | m_iState.x);
     endInstruction();
     break;
   }
@@ -1035,10 +1198,10 @@ void CPU::LDH_n_A()
   {
   case 1: m_currentInstr = &CPU::LDH_n_A; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     break;
   case 3:
-    m_bus.write(0xFF00 | m_iState.x, m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(0xFF00 | m_iState.x, m_registers[a]);
     endInstruction();
     break;
   }
@@ -1050,7 +1213,7 @@ void CPU::LD_A_HLd()
   {
   case 1: m_currentInstr = &CPU::LD_A_HLd; break;
   case 2:
-    m_registers[a] = m_bus.read(getHl(), MMU::Component::cpu);
+    m_registers[a] = m_bus.read<MMU::Component::cpu>(getHl());
     if(--m_registers[l] == 0xFF) --m_registers[h]; //check for underflow
     endInstruction();
     break;
@@ -1064,7 +1227,7 @@ void CPU::LD_HLd_A()
   case 1: m_currentInstr = &CPU::LD_HLd_A; break;
   case 2:
 
-    m_bus.write(getHl(), m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_registers[a]);
     if(--m_registers[l] == 0xFF) --m_registers[h];
     endInstruction();
     break;
@@ -1077,7 +1240,7 @@ void CPU::LD_A_HLi()
   {
   case 1: m_currentInstr = &CPU::LD_A_HLi; break;
   case 2:
-    m_registers[a] = m_bus.read(getHl(), MMU::Component::cpu);
+    m_registers[a] = m_bus.read<MMU::Component::cpu>(getHl());
     if(++m_registers[l] == 0x00) ++m_registers[h]; //check for overflow
     endInstruction();
     break;
@@ -1090,7 +1253,7 @@ void CPU::LD_HLi_A()
   {
   case 1: m_currentInstr = &CPU::LD_HLi_A; break;
   case 2:
-    m_bus.write(getHl(), m_registers[a], MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_registers[a]);
     if(++m_registers[l] == 0x00) ++m_registers[h];
     endInstruction();
     break;
@@ -1105,9 +1268,9 @@ void CPU::LD_rr_nn()
     m_currentInstr = &CPU::LD_rr_nn;
     m_iState.x = (m_ir >> 4) & 0b11; //rr
     break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     switch(m_iState.x)
     {
     case bc: setBc(m_iState.xx); break;
@@ -1125,13 +1288,13 @@ void CPU::LD_nn_SP()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::LD_nn_SP; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     break;
-  case 4: m_bus.write(m_iState.xx, getLsb(m_sp), MMU::Component::cpu); break;
+  case 4: m_bus.write<MMU::Component::cpu>(m_iState.xx, getLsb(m_sp)); break;
   case 5:
-    m_bus.write(m_iState.xx + 1, getMsb(m_sp), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(m_iState.xx + 1, getMsb(m_sp));
     endInstruction();
     break;
   }
@@ -1161,19 +1324,19 @@ void CPU::PUSH_rr()
   case 3:
     switch(m_iState.x)
     {
-    case bc: m_bus.write(--m_sp, m_registers[b], MMU::Component::cpu); break;
-    case de: m_bus.write(--m_sp, m_registers[d], MMU::Component::cpu); break;
-    case hl: m_bus.write(--m_sp, m_registers[h], MMU::Component::cpu); break;
-    case af: m_bus.write(--m_sp, m_registers[a], MMU::Component::cpu); break;
+    case bc: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[b]); break;
+    case de: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[d]); break;
+    case hl: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[h]); break;
+    case af: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[a]); break;
     }
     break;
   case 4:
     switch(m_iState.x)
     {
-    case bc: m_bus.write(--m_sp, m_registers[c], MMU::Component::cpu); break;
-    case de: m_bus.write(--m_sp, m_registers[e], MMU::Component::cpu); break;
-    case hl: m_bus.write(--m_sp, m_registers[l], MMU::Component::cpu); break;
-    case af: m_bus.write(--m_sp, m_f & 0xF0, MMU::Component::cpu); break;
+    case bc: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[c]); break;
+    case de: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[e]); break;
+    case hl: m_bus.write<MMU::Component::cpu>(--m_sp, m_registers[l]); break;
+    case af: m_bus.write<MMU::Component::cpu>(--m_sp, m_f & 0xF0); break;
     }
     endInstruction();
     break;
@@ -1185,9 +1348,9 @@ void CPU::POP_rr()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::POP_rr; break;
-  case 2: m_iState.xx = m_bus.read(m_sp++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_sp++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_sp++, MMU::Component::cpu) << 8;
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_sp++) << 8;
     m_iState.x = (m_ir >> 4) & 0b11; //rr
     switch(m_iState.x)
     {
@@ -1210,7 +1373,7 @@ void CPU::LD_HL_SP_e()
   {
   case 1: m_currentInstr = &CPU::LD_HL_SP_e; break;
   case 2:
-    m_iState.e = static_cast<int8>(m_bus.read(m_pc++, MMU::Component::cpu)); //e
+    m_iState.e = static_cast<int8>(m_bus.read<MMU::Component::cpu>(m_pc++)); //e
     break;
   case 3:
     setHl(static_cast<uint16>(m_sp + m_iState.e));
@@ -1245,7 +1408,7 @@ void CPU::ADD_HL()
   {
   case 1: m_currentInstr = &CPU::ADD_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     m_iState.xx = m_registers[a] + m_iState.x;             //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1265,7 +1428,7 @@ void CPU::ADD_n()
   {
   case 1: m_currentInstr = &CPU::ADD_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     m_iState.xx = m_registers[a] + m_iState.x;            //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1299,7 +1462,7 @@ void CPU::ADC_HL()
   {
   case 1: m_currentInstr = &CPU::ADC_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     m_iState.xx = m_registers[a] + m_iState.x + getFc();   //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1319,7 +1482,7 @@ void CPU::ADC_n()
   {
   case 1: m_currentInstr = &CPU::ADC_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     m_iState.xx = m_registers[a] + m_iState.x + getFc();  //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1353,7 +1516,7 @@ void CPU::SUB_HL()
   {
   case 1: m_currentInstr = &CPU::SUB_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     m_iState.xx = m_registers[a] - m_iState.x;             //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1373,7 +1536,7 @@ void CPU::SUB_n()
   {
   case 1: m_currentInstr = &CPU::SUB_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     m_iState.xx = m_registers[a] - m_iState.x;            //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1407,7 +1570,7 @@ void CPU::SBC_HL()
   {
   case 1: m_currentInstr = &CPU::SBC_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     m_iState.xx = m_registers[a] - m_iState.x - getFc();   //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1427,7 +1590,7 @@ void CPU::SBC_n()
   {
   case 1: m_currentInstr = &CPU::SBC_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     m_iState.xx = m_registers[a] - m_iState.x - getFc();  //result
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1459,7 +1622,7 @@ void CPU::CP_HL()
   {
   case 1: m_currentInstr = &CPU::CP_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     m_iState.xx = m_registers[a] - m_iState.x;
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1478,7 +1641,7 @@ void CPU::CP_n()
   {
   case 1: m_currentInstr = &CPU::CP_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
     m_iState.xx = m_registers[a] - m_iState.x;
 
     setFz((m_iState.xx & 0xFF) == 0);
@@ -1509,10 +1672,10 @@ void CPU::INC_HL()
   {
   case 1: m_currentInstr = &CPU::INC_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 3:
-    m_bus.write(getHl(), m_iState.x + 1, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.x + 1);
 
     setFz(m_iState.x == 0xFF);
     setFn(false);
@@ -1540,10 +1703,10 @@ void CPU::DEC_HL()
   {
   case 1: m_currentInstr = &CPU::DEC_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 3:
-    m_bus.write(getHl(), m_iState.x - 1, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.x - 1);
 
     setFz((m_iState.x - 1) == 0);
     setFn(true);
@@ -1573,7 +1736,7 @@ void CPU::AND_HL()
   {
   case 1: m_currentInstr = &CPU::AND_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
 
     m_registers[a] &= m_iState.x;
 
@@ -1593,7 +1756,7 @@ void CPU::AND_n()
   {
   case 1: m_currentInstr = &CPU::AND_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
 
     m_registers[a] &= m_iState.x;
 
@@ -1628,7 +1791,7 @@ void CPU::OR_HL()
   {
   case 1: m_currentInstr = &CPU::OR_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
 
     m_registers[a] |= m_iState.x;
 
@@ -1648,7 +1811,7 @@ void CPU::OR_n()
   {
   case 1: m_currentInstr = &CPU::OR_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
 
     m_registers[a] |= m_iState.x;
 
@@ -1681,7 +1844,7 @@ void CPU::XOR_HL()
   {
   case 1: m_currentInstr = &CPU::XOR_HL; break;
   case 2:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
 
     m_registers[a] ^= m_iState.x;
 
@@ -1701,7 +1864,7 @@ void CPU::XOR_n()
   {
   case 1: m_currentInstr = &CPU::XOR_n; break;
   case 2:
-    m_iState.x = m_bus.read(m_pc++, MMU::Component::cpu); //n
+    m_iState.x = m_bus.read<MMU::Component::cpu>(m_pc++); //n
 
     m_registers[a] ^= m_iState.x;
 
@@ -1842,7 +2005,7 @@ void CPU::ADD_SP_e()
   {
   case 1: m_currentInstr = &CPU::ADD_SP_e; break;
   case 2:
-    m_iState.e = static_cast<int8>(m_bus.read(m_pc++, MMU::Component::cpu)); //e
+    m_iState.e = static_cast<int8>(m_bus.read<MMU::Component::cpu>(m_pc++)); //e
     break;
   case 3: break;
   case 4:
@@ -1933,13 +2096,13 @@ void CPU::RLC_HL()
   case 1: m_currentInstr = &CPU::RLC_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = m_iState.x >> 7;                //bit out
     m_iState.z = (m_iState.x << 1) | m_iState.y; //result
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -1977,13 +2140,13 @@ void CPU::RRC_HL()
   case 1: m_currentInstr = &CPU::RRC_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = (m_iState.x & 1) << 7;          //bit out
     m_iState.z = (m_iState.x >> 1) | m_iState.y; //result
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -2020,13 +2183,13 @@ void CPU::RL_HL()
   case 1: m_currentInstr = &CPU::RL_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = m_iState.x >> 7;                                 //bit out
     m_iState.z = (m_iState.x << 1) | static_cast<uint8>(getFc()); //result
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -2064,13 +2227,13 @@ void CPU::RR_HL()
   case 1: m_currentInstr = &CPU::RR_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = m_iState.x & 1;                                         //bit out
     m_iState.z = (m_iState.x >> 1) | (static_cast<uint8>(getFc()) << 7); //result
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -2108,13 +2271,13 @@ void CPU::SLA_HL()
   case 1: m_currentInstr = &CPU::SLA_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = m_iState.x >> 7; //bit out
     m_iState.z = m_iState.x << 1; //result
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -2152,12 +2315,12 @@ void CPU::SRA_HL()
   {
   case 1: m_currentInstr = &CPU::SRA_HL; break;
   case 2: break;
-  case 3: m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); break;
+  case 3: m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); break;
   case 4:
     m_iState.y = m_iState.x & 1;                          // bit out
     m_iState.z = (m_iState.x >> 1) | (m_iState.x & 0x80); //z = result, x & 0x80 = sign bit
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -2193,12 +2356,12 @@ void CPU::SWAP_HL()
   case 1: m_currentInstr = &CPU::SWAP_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = ((m_iState.x & 0xF0) >> 4) | ((m_iState.x & 0xF) << 4); //result
 
-    m_bus.write(getHl(), m_iState.y, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.y);
 
     setFz(m_iState.y == 0);
     setFn(false);
@@ -2236,13 +2399,13 @@ void CPU::SRL_HL()
   case 1: m_currentInstr = &CPU::SRL_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = m_iState.x & 1;  //bit out
     m_iState.z = m_iState.x >> 1; //result
 
-    m_bus.write(getHl(), m_iState.z, MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.z);
 
     setFz(m_iState.z == 0);
     setFn(false);
@@ -2279,7 +2442,7 @@ void CPU::BIT_b_HL()
   case 2: break;
   case 3:
     m_iState.x = (m_ir >> 3) & 0b111;                      //b
-    m_iState.y = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.y = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
 
     setFz((m_iState.y & (1 << m_iState.x)) == 0);
     setFn(false);
@@ -2310,12 +2473,12 @@ void CPU::RES_b_HL()
   case 1: m_currentInstr = &CPU::RES_b_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = (m_ir >> 3) & 0b111; //b
 
-    m_bus.write(getHl(), m_iState.x & ~(1 << m_iState.y), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.x & ~(1 << m_iState.y));
     endInstruction();
     break;
   }
@@ -2343,12 +2506,12 @@ void CPU::SET_b_HL()
   case 1: m_currentInstr = &CPU::SET_b_HL; break;
   case 2: break;
   case 3:
-    m_iState.x = m_bus.read(getHl(), MMU::Component::cpu); //HL mem
+    m_iState.x = m_bus.read<MMU::Component::cpu>(getHl()); //HL mem
     break;
   case 4:
     m_iState.y = (m_ir >> 3) & 0b111; //b
 
-    m_bus.write(getHl(), m_iState.x | (1 << m_iState.y), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(getHl(), m_iState.x | (1 << m_iState.y));
     endInstruction();
     break;
   }
@@ -2359,9 +2522,9 @@ void CPU::JP_nn()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::JP_nn; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     break;
   case 4:
     m_pc = m_iState.xx;
@@ -2381,9 +2544,9 @@ void CPU::JP_cc_nn()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::JP_cc_nn; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     m_iState.x = (m_ir >> 3) & 0b11;                             //cc
 
     switch(m_iState.x) //m_iState.y is used as a bool to check later if condition is met
@@ -2407,7 +2570,7 @@ void CPU::JR_e()
   {
   case 1: m_currentInstr = &CPU::JR_e; break;
   case 2:
-    m_iState.e = static_cast<int8>(m_bus.read(m_pc++, MMU::Component::cpu)); //e
+    m_iState.e = static_cast<int8>(m_bus.read<MMU::Component::cpu>(m_pc++)); //e
     break;
   case 3:
     m_pc += m_iState.e;
@@ -2425,7 +2588,7 @@ void CPU::JR_cc_e()
     m_iState.x = (m_ir >> 3) & 0b11; //cc
     break;
   case 2:
-    m_iState.e = static_cast<int8>(m_bus.read(m_pc++, MMU::Component::cpu)); //e
+    m_iState.e = static_cast<int8>(m_bus.read<MMU::Component::cpu>(m_pc++)); //e
 
     switch(m_iState.x) //m_iState.y is used as a bool to check later if condition is met
     {
@@ -2447,14 +2610,14 @@ void CPU::CALL_nn()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::CALL_nn; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     break;
   case 4: break;
-  case 5: m_bus.write(--m_sp, getMsb(m_pc), MMU::Component::cpu); break;
+  case 5: m_bus.write<MMU::Component::cpu>(--m_sp, getMsb(m_pc)); break;
   case 6:
-    m_bus.write(--m_sp, getLsb(m_pc), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(--m_sp, getLsb(m_pc));
     m_pc = m_iState.xx;
     endInstruction();
     break;
@@ -2466,9 +2629,9 @@ void CPU::CALL_cc_nn()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::CALL_cc_nn; break;
-  case 2: m_iState.xx = m_bus.read(m_pc++, MMU::Component::cpu); break;
+  case 2: m_iState.xx = m_bus.read<MMU::Component::cpu>(m_pc++); break;
   case 3:
-    m_iState.xx |= m_bus.read(m_pc++, MMU::Component::cpu) << 8; //nn
+    m_iState.xx |= m_bus.read<MMU::Component::cpu>(m_pc++) << 8; //nn
     m_iState.x = (m_ir >> 3) & 0b11;                             //cc
 
     switch(m_iState.x) //m_iState.y is used as a bool to check later if condition is met
@@ -2482,9 +2645,9 @@ void CPU::CALL_cc_nn()
     if(!m_iState.y) endInstruction();
     break;
   case 4: break;
-  case 5: m_bus.write(--m_sp, getMsb(m_pc), MMU::Component::cpu); break;
+  case 5: m_bus.write<MMU::Component::cpu>(--m_sp, getMsb(m_pc)); break;
   case 6:
-    m_bus.write(--m_sp, getLsb(m_pc), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(--m_sp, getLsb(m_pc));
     m_pc = m_iState.xx;
     endInstruction();
     break;
@@ -2496,8 +2659,8 @@ void CPU::RET()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::RET; break;
-  case 2: m_iState.x = m_bus.read(m_sp++, MMU::Component::cpu); break;
-  case 3: m_iState.y = m_bus.read(m_sp++, MMU::Component::cpu); break;
+  case 2: m_iState.x = m_bus.read<MMU::Component::cpu>(m_sp++); break;
+  case 3: m_iState.y = m_bus.read<MMU::Component::cpu>(m_sp++); break;
   case 4:
     m_pc = (m_iState.y << 8) | m_iState.x;
     endInstruction();
@@ -2524,8 +2687,8 @@ void CPU::RET_cc()
 
     if(!m_iState.y) endInstruction();
     break;
-  case 3: m_iState.x = m_bus.read(m_sp++, MMU::Component::cpu); break;
-  case 4: m_iState.y = m_bus.read(m_sp++, MMU::Component::cpu); break;
+  case 3: m_iState.x = m_bus.read<MMU::Component::cpu>(m_sp++); break;
+  case 4: m_iState.y = m_bus.read<MMU::Component::cpu>(m_sp++); break;
   case 5:
     m_pc = (m_iState.y << 8) | m_iState.x;
     endInstruction();
@@ -2538,8 +2701,8 @@ void CPU::RETI()
   switch(m_cycleCounter)
   {
   case 1: m_currentInstr = &CPU::RETI; break;
-  case 2: m_iState.x = m_bus.read(m_sp++, MMU::Component::cpu); break;
-  case 3: m_iState.y = m_bus.read(m_sp++, MMU::Component::cpu); break;
+  case 2: m_iState.x = m_bus.read<MMU::Component::cpu>(m_sp++); break;
+  case 3: m_iState.y = m_bus.read<MMU::Component::cpu>(m_sp++); break;
   case 4:
     m_pc = (m_iState.y << 8) | m_iState.x;
     m_ime = true;
@@ -2554,9 +2717,9 @@ void CPU::RST_n()
   {
   case 1: m_currentInstr = &CPU::RST_n; break;
   case 2: break;
-  case 3: m_bus.write(--m_sp, getMsb(m_pc), MMU::Component::cpu); break;
+  case 3: m_bus.write<MMU::Component::cpu>(--m_sp, getMsb(m_pc)); break;
   case 4:
-    m_bus.write(--m_sp, getLsb(m_pc), MMU::Component::cpu);
+    m_bus.write<MMU::Component::cpu>(--m_sp, getLsb(m_pc));
     m_pc = m_ir & 0b111000;
     endInstruction();
     break;
@@ -2566,8 +2729,8 @@ void CPU::RST_n()
 void CPU::HALT()
 {
   m_cycleCounter = 0;
-  if(!m_ime &&
-     ((m_bus.read(hardwareReg::IF, MMU::Component::cpu) & m_bus.read(hardwareReg::IE, MMU::Component::cpu)) & 0b1'1111))
+  if(!m_ime && ((m_bus.read<MMU::Component::cpu>(hardwareReg::IF) & m_bus.read<MMU::Component::cpu>(hardwareReg::IE)) &
+                0b1'1111))
   {
     m_haltBug = true;
     return;
@@ -3,12 +3,36 @@
 #include <array>
 
 class MMU;
+class StateWriter;
+class StateReader;
 class CPU
 {
 public:
+  struct Registers
+  {
+    uint8 a{};
+    uint8 f{};
+    uint8 b{};
+    uint8 c{};
+    uint8 d{};
+    uint8 e{};
+    uint8 h{};
+    uint8 l{};
+    uint16 sp{};
+    uint16 pc{};
+    bool ime{};
+    bool halted{};
+
+    bool operator==(const Registers&) const = default;
+  };
+
   CPU(MMU& bus);
   void reset();
   void mCycle();
+  Registers getRegisters() const;
+
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
 
 private:
   using InstructionHandler = void (CPU::*)(); //pointer to a instruction function
@@ -59,6 +83,9 @@ private:
     0x60, //Joypad
   };
 
+  //every handler m_currentInstr can point to, save states store the index instead of the pointer
+  static const std::array<InstructionHandler, 105> instructionHandlers;
+
   static constexpr uint8 zeroFlag{0b1000'0000};
   static constexpr uint8 negativeFlag{0b0100'0000};
   static constexpr uint8 halfCarryFlag{0b0010'0000};
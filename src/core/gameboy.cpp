@@ -1,26 +1,59 @@
 #include "core/gameboy.h"
 #include "config.h"
+#include "core/cartridge/rom_image.h"
+#include "core/save_state.h"
 #include "platform.h"
+#include <iostream>
 
 Gameboy::Gameboy()
-  : m_bus{*this}
+  : m_ownedLcdBuffer{}
+  , m_lcdBuffer{Platform::getInstance().getLcdTexturePtr()}
+  , m_bus{*this}
   , m_cpu{m_bus}
-  , m_ppu{m_bus, Platform::getInstance().getLcdTexturePtr(), PPU::stringToPaletteIndex(Config::getInstance().getPalette())}
+  , m_ppu{m_bus, m_lcdBuffer, PPU::stringToPaletteIndex(Config::getInstance().getPalette())}
   , m_apu{m_bus, Config::getInstance().getVolume()}
   , m_timers{m_bus}
   , m_input{}
-  , m_currentCycle{}
+  , m_romCheats{}
+  , m_ramCheats{}
+  , m_cycle{}
+  , m_cyclesLeft{}
+  , m_frameStartCycle{}
+  , m_accuracy{Accuracy::accurate}
+  , m_keyboard{true}
+  , m_deterministic{}
+{
+}
+
+Gameboy::Gameboy(uint16* lcdBuffer, PPU::PaletteIndex palette, bool audioOutput)
+  : m_ownedLcdBuffer(lcdBuffer ? 0 : PPU::lcdWidth * PPU::lcdHeight)
+  , m_lcdBuffer{lcdBuffer ? lcdBuffer : m_ownedLcdBuffer.data()}
+  , m_bus{*this}
+  , m_cpu{m_bus}
+  , m_ppu{m_bus, m_lcdBuffer, palette}
+  , m_apu{m_bus, audioOutput ? Config::getInstance().getVolume() : 0.f, audioOutput}
+  , m_timers{m_bus}
+  , m_input{false}
+  , m_romCheats{}
+  , m_ramCheats{}
+  , m_cycle{}
+  , m_cyclesLeft{}
+  , m_frameStartCycle{}
+  , m_accuracy{Accuracy::accurate}
+  , m_keyboard{false}
+  , m_deterministic{}
 {
 }
 
 void Gameboy::reset()
 {
+  m_cycle = 0;
+  m_frameStartCycle = 0;
   m_bus.reset();
   m_cpu.reset();
   m_ppu.reset();
   m_apu.reset();
   m_timers.reset();
-  m_currentCycle = 1;
 }
 
 Gameboy::~Gameboy()
@@ -30,31 +63,92 @@ Gameboy::~Gameboy()
 
 void Gameboy::frame()
 {
-  static constexpr int mCyclePerFrame{17556};
-  for(; m_currentCycle <= mCyclePerFrame; ++m_currentCycle) mCycle();
-  m_currentCycle = 1;
-  m_bus.getCartridgeSlot().clockFrame();
-  m_apu.unlockThread();
+  run(mCyclesPerFrame - frameCycle(), true);
+}
+
+uint32 Gameboy::runCycles(uint32 mCycles, bool stopAtFrameEnd)
+{
+  return run(mCycles, stopAtFrameEnd);
 }
 
+uint32 Gameboy::run(uint32 mCycles, bool stopAtFrameEnd)
+{
+  const uint64_t start{m_cycle};
+  if(m_accuracy == Accuracy::fast) run<Accuracy::fast>(mCycles, stopAtFrameEnd);
+  else run<Accuracy::accurate>(mCycles, stopAtFrameEnd);
+  m_bus.syncDma(); //oam views stay current when a run stops mid transfer
+  return static_cast<uint32>(m_cycle - start);
+}
+
+template<Accuracy profile>
+void Gameboy::run(uint32 mCycles, bool stopAtFrameEnd)
+{
+  for(m_cyclesLeft = mCycles; m_cyclesLeft > 0; --m_cyclesLeft)
+  {
+    ++m_cycle;
+    mCycle<profile>();
+
+    //frames end when the ppu enters vblank, the cycle limit only kicks in while the lcd is off
+    if(m_ppu.takeFrameReady() || frameCycle() == mCyclesPerFrame)
+    {
+      endFrame();
+      if(stopAtFrameEnd) return;
+    }
+  }
+}
+
+template<Accuracy profile>
 void Gameboy::mCycle()
 {
   m_cpu.mCycle();
-  m_bus.handleDmaTransfer();
   m_timers.mCycle();
-  m_ppu.mCycle();
+  m_ppu.mCycle<profile>();
+}
+
+void Gameboy::stopRun()
+{
+  m_cyclesLeft = 1;
+}
+
+void Gameboy::setAccuracy(const Accuracy accuracy)
+{
+  m_accuracy = accuracy;
+  m_bus.setAccuracy(accuracy);
+}
+
+void Gameboy::endFrame()
+{
+  for(const RamCheat& cheat : m_ramCheats) m_bus.write<MMU::Component::bus>(cheat.address, cheat.value);
+  m_bus.getCartridgeSlot().clock(frameCycle());
+  m_frameStartCycle = m_cycle;
+#ifdef BBOY_HEATMAP
+  m_bus.getHeatmap().endFrame(m_cycle);
+#endif
+  m_apu.unlockThread();
+}
+
+void Gameboy::openRom(const std::filesystem::path& filePath, const Accuracy accuracy,
+                      const std::filesystem::path& patchPath)
+{
+  reset();
+  setAccuracy(accuracy);
+  m_bus.getCartridgeSlot().loadCartridge(filePath, patchPath);
+  m_bus.mapCartridge();
 }
 
-void Gameboy::openRom(const std::filesystem::path& filePath)
+void Gameboy::openRom(std::shared_ptr<const RomImage> rom, const std::string& name, const Accuracy accuracy)
 {
   reset();
-  m_bus.getCartridgeSlot().loadCartridge(filePath);
+  setAccuracy(accuracy);
+  m_bus.getCartridgeSlot().loadCartridge(std::move(rom), name);
+  m_bus.mapCartridge();
 }
 
 void Gameboy::hardReset()
 {
   reset();
   m_bus.getCartridgeSlot().reloadCartridge();
+  m_bus.mapCartridge();
 }
 
 std::string Gameboy::getRomName()
@@ -67,7 +161,124 @@ bool Gameboy::hasRom()
   return m_bus.getCartridgeSlot().hasCartridge();
 }
 
-uint16 Gameboy::currentCycle() const
+uint64_t Gameboy::currentCycle() const
+{
+  return m_cycle;
+}
+
+uint16 Gameboy::frameCycle() const
+{
+  return static_cast<uint16>(m_cycle - m_frameStartCycle);
+}
+
+Accuracy Gameboy::getAccuracy() const
 {
-  return m_currentCycle;
+  return m_accuracy;
+}
+
+const uint16* Gameboy::getLcdBuffer() const
+{
+  return m_lcdBuffer;
+}
+
+MMU& Gameboy::getBus()
+{
+  return m_bus;
+}
+
+const CPU& Gameboy::getCpu() const
+{
+  return m_cpu;
+}
+
+void Gameboy::setButtons(const uint8 pressed)
+{
+  m_input.setButtons(pressed);
+}
+
+void Gameboy::setLcdOutput(const PPU::Output output)
+{
+  m_ppu.setOutput(output);
+}
+
+void Gameboy::setDeterministic(const bool deterministic, const std::optional<uint64_t> ramSeed)
+{
+  m_deterministic = deterministic;
+  m_input.setKeyboard(m_keyboard && !deterministic);
+  m_apu.setDeterministic(deterministic);
+  m_bus.getCartridgeSlot().setBatterySaves(!deterministic);
+  m_bus.getCartridgeSlot().setRtcClock(deterministic ? &m_cycle : nullptr);
+  m_bus.setRamSeed(ramSeed);
+}
+
+bool Gameboy::addCheat(std::string_view code)
+{
+  if(const std::optional<RomCheat> cheat{Cheats::parseGameGenie(code)})
+  {
+    m_romCheats.push_back(*cheat);
+    m_bus.getCartridgeSlot().setRomCheats(m_romCheats);
+    m_bus.mapCartridge();
+    return true;
+  }
+  if(const std::optional<RamCheat> cheat{Cheats::parseGameShark(code)})
+  {
+    m_ramCheats.push_back(*cheat);
+    return true;
+  }
+  std::cerr << "Unknown cheat code " << code << '\n';
+  return false;
+}
+
+void Gameboy::clearCheats()
+{
+  m_romCheats.clear();
+  m_ramCheats.clear();
+  m_bus.getCartridgeSlot().setRomCheats(m_romCheats);
+  m_bus.mapCartridge();
+}
+
+bool Gameboy::isDeterministic() const
+{
+  return m_deterministic;
+}
+
+void Gameboy::saveState(std::vector<uint8>& buffer)
+{
+  buffer.clear();
+  StateWriter state{buffer};
+  state.write(stateMagic);
+  state.write(stateVersion);
+  state.write(m_cycle);
+  state.write(m_frameStartCycle);
+  m_cpu.saveState(state);
+  m_ppu.saveState(state);
+  m_apu.saveState(state);
+  m_timers.saveState(state);
+  m_input.saveState(state);
+  m_bus.saveState(state);
+}
+
+bool Gameboy::loadState(const uint8* data, size_t size)
+{
+  StateReader state{data, size};
+  uint32 magic{};
+  uint32 version{};
+  state.read(magic);
+  state.read(version);
+  if(state.failed() || magic != stateMagic || version != stateVersion) return false;
+
+  std::vector<uint8> backup{};
+  saveState(backup);
+
+  state.read(m_cycle);
+  state.read(m_frameStartCycle);
+  m_cpu.loadState(state);
+  m_ppu.loadState(state);
+  m_apu.loadState(state);
+  m_timers.loadState(state);
+  m_input.loadState(state);
+  if(m_bus.loadState(state) && !state.failed()) return true;
+
+  loadState(backup.data(), backup.size());
+  return false;
 }
@@ -1,30 +1,72 @@
 #pragma once
 #include "core/apu/apu.h"
+#include "core/cheats.h"
 #include "core/cpu.h"
 #include "core/input.h"
 #include "core/mmu.h"
 #include "core/ppu/ppu.h"
 #include "core/timers.h"
 #include "type_alias.h"
+#include <vector>
 
 class Gameboy
 {
 public:
-  Gameboy();
+  Gameboy(); //draws to the platform texture and outputs audio
+  //headless instance taking input from setButtons, if lcdBuffer is null the gameboy allocates its own
+  explicit Gameboy(uint16* lcdBuffer, PPU::PaletteIndex palette = PPU::PaletteIndex::grey, bool audioOutput = false);
   ~Gameboy();
 
   void reset();
-  void frame();
+  void frame(); //runs until the ppu enters vblank, or for a frame worth of cycles while the lcd is off
+  uint32 runCycles(uint32 mCycles, bool stopAtFrameEnd = false); //can stop and resume mid frame, returns the cycles run
 
-  void openRom(const std::filesystem::path& filePath);
+  //the accuracy profile is fixed until the next rom is opened. without a patch path a .ips or .bps with the rom's name
+  //is applied if there is one
+  void openRom(const std::filesystem::path& filePath, const Accuracy accuracy = Accuracy::accurate,
+               const std::filesystem::path& patchPath = {});
+  void openRom(std::shared_ptr<const RomImage> rom, const std::string& name, const Accuracy accuracy = Accuracy::accurate);
   void hardReset();
   std::string getRomName();
   bool hasRom();
-  uint16 currentCycle() const;
+  uint64_t currentCycle() const; //master clock, m-cycles since the last reset
+  uint16 frameCycle() const;     //m-cycles into the current frame
+  Accuracy getAccuracy() const;
+  const uint16* getLcdBuffer() const;
+  MMU& getBus();
+  const CPU& getCpu() const;
+  void setButtons(const uint8 pressed); //Input::Button flags, only for instances without keyboard
+  void setLcdOutput(const PPU::Output output);
+
+  //every external influence becomes an explicit input: no keyboard, no .sav files, an rtc running on the emulated clock
+  //and audio that doesn't follow the host queue. the ram seed and the rtc clock are applied when the next rom is
+  //opened, without a seed ram starts cleared
+  void setDeterministic(const bool deterministic, const std::optional<uint64_t> ramSeed = std::nullopt);
+  bool isDeterministic() const;
+
+  //game genie codes (ABC-DEF or ABC-DEF-GHI) patch the banks they apply to, so reads cost nothing extra. gameshark
+  //codes (TTVVLLHH) write their byte at the end of every frame. false for anything else, kept across roms and resets
+  bool addCheat(std::string_view code);
+  void clearCheats();
+
+  void saveState(std::vector<uint8>& buffer);
+  bool loadState(const uint8* data, size_t size); //on failure the current state is kept
+
+  static constexpr uint16 mCyclesPerFrame{17556};
+  static constexpr uint32 stateVersion{6};
+  static constexpr uint32 stateMagic{0x594F4242}; //"BBOY" as little endian bytes
 
 private:
   friend class MMU;
-  void mCycle();
+  uint32 run(uint32 mCycles, bool stopAtFrameEnd);
+  template<Accuracy profile> void run(uint32 mCycles, bool stopAtFrameEnd);
+  void stopRun(); //the run loop returns after the current cycle
+  template<Accuracy profile> void mCycle();
+  void setAccuracy(const Accuracy accuracy);
+  void endFrame();
+
+  std::vector<uint16> m_ownedLcdBuffer; //declared first so it exists before m_ppu gets its pointer
+  uint16* m_lcdBuffer;
 
   MMU m_bus;
   CPU m_cpu;
@@ -33,6 +75,13 @@ private:
 
   Timers m_timers;
   Input m_input;
+  std::vector<RomCheat> m_romCheats;
+  std::vector<RamCheat> m_ramCheats;
 
-  uint16 m_currentCycle;
+  uint64_t m_cycle; //counts the cycle being executed, so components see the current one
+  uint32 m_cyclesLeft; //in the current run, a member so stopping needs no extra check in the loop
+  uint64_t m_frameStartCycle;
+  Accuracy m_accuracy;
+  bool m_keyboard;
+  bool m_deterministic;
 };
@@ -0,0 +1,177 @@
+#include "core/heatmap.h"
+#include "core/gameboy.h"
+#include "memory_regions.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+constexpr std::array<std::string_view, Heatmap::componentCount> componentNames{"cpu", "ppu", "bus", "timers"};
+constexpr std::array<std::string_view, Heatmap::kindCount> kindNames{"read", "write"};
+} //namespace
+
+Heatmap::Heatmap()
+  : m_counts(componentCount * kindCount * lineCount)
+  , m_startCycle{}
+  , m_frameDump{}
+{
+}
+
+void Heatmap::clear(const uint64_t cycle)
+{
+  std::fill(m_counts.begin(), m_counts.end(), 0);
+  m_startCycle = cycle;
+}
+
+void Heatmap::endFrame(const uint64_t cycle)
+{
+  if(!m_frameDump.is_open()) return;
+  writeRecord(m_frameDump, cycle);
+  clear(cycle);
+}
+
+bool Heatmap::startFrameDump(const std::filesystem::path& path)
+{
+  m_frameDump.open(path, std::ios::binary | std::ios::trunc);
+  if(m_frameDump.fail())
+  {
+    std::cerr << "Couldn't open heatmap dump " << path << '\n';
+    return false;
+  }
+  writeHeader(m_frameDump);
+  return true;
+}
+
+bool Heatmap::save(const std::filesystem::path& path, const uint64_t cycle) const
+{
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  if(file.fail())
+  {
+    std::cerr << "Couldn't open heatmap dump " << path << '\n';
+    return false;
+  }
+  writeHeader(file);
+  writeRecord(file, cycle);
+  return !file.fail();
+}
+
+void Heatmap::writeHeader(std::ostream& file)
+{
+  const std::array<uint32, 6> header{dumpMagic, dumpVersion, lineSize, lineCount, componentCount, kindCount};
+  file.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+}
+
+void Heatmap::writeRecord(std::ostream& file, const uint64_t cycle) const
+{
+  const std::array<uint64_t, 2> span{m_startCycle, cycle - m_startCycle};
+  file.write(reinterpret_cast<const char*>(span.data()), sizeof(span));
+  file.write(reinterpret_cast<const char*>(m_counts.data()), m_counts.size() * sizeof(uint64_t));
+}
+
+bool Heatmap::report(const std::filesystem::path& path, std::ostream& out, const size_t hottestLines)
+{
+  std::ifstream file{path, std::ios::binary};
+  if(file.fail())
+  {
+    std::cerr << "Couldn't open heatmap dump " << path << '\n';
+    return false;
+  }
+
+  std::array<uint32, 6> header{};
+  file.read(reinterpret_cast<char*>(header.data()), sizeof(header));
+  if(file.fail() ||
+     header != std::array<uint32, 6>{dumpMagic, dumpVersion, lineSize, lineCount, componentCount, kindCount})
+  {
+    std::cerr << path << " is not a heatmap dump of this version\n";
+    return false;
+  }
+
+  const size_t counterCount{componentCount * kindCount * lineCount};
+  std::vector<uint64_t> totals(counterCount);
+  std::vector<uint64_t> record(counterCount);
+  std::array<uint64_t, 2> span{};
+  uint64_t records{};
+  uint64_t cycles{};
+  while(file.read(reinterpret_cast<char*>(span.data()), sizeof(span)) &&
+        file.read(reinterpret_cast<char*>(record.data()), counterCount * sizeof(uint64_t)))
+  {
+    ++records;
+    cycles += span[1];
+    for(size_t i{}; i < counterCount; ++i) totals[i] += record[i];
+  }
+
+  const double frames{static_cast<double>(cycles) / Gameboy::mCyclesPerFrame};
+  out << records << " records, " << cycles << " m-cycles (" << std::fixed << std::setprecision(1) << frames
+      << " frames)\n\n";
+
+  auto counter{[&totals](size_t component, size_t kind, size_t line)
+  {
+    return totals[(component * kindCount + kind) * lineCount + line];
+  }};
+
+  out << std::left << std::setw(10) << "component" << std::right << std::setw(14) << "reads" << std::setw(14) << "writes"
+      << '\n';
+  for(size_t component{}; component < componentCount; ++component)
+  {
+    uint64_t sums[kindCount]{};
+    for(size_t kind{}; kind < kindCount; ++kind)
+      for(size_t line{}; line < lineCount; ++line) sums[kind] += counter(component, kind, line);
+    out << std::left << std::setw(10) << componentNames[component] << std::right << std::setw(14) << sums[read]
+        << std::setw(14) << sums[write] << '\n';
+  }
+
+  using namespace MemoryRegions;
+  struct Region
+  {
+    std::string_view name;
+    std::pair<uint16, uint16> range;
+  };
+  constexpr std::array<Region, 10> regions{{{"rom0", romBank0},
+                                            {"romx", romBank1},
+                                            {"vram", vram},
+                                            {"sram", externalRam},
+                                            {"wram", {workRam0.first, workRam1.second}},
+                                            {"echo", echoRam},
+                                            {"oam", oam},
+                                            {"unusable", notUsable},
+                                            {"io", hardwareRegisters},
+                                            {"hram+ie", {highRam.first, 0xFFFF}}}};
+  out << '\n' << std::left << std::setw(10) << "region" << std::right << std::setw(14) << "reads" << std::setw(14)
+      << "writes" << '\n';
+  for(const Region& region : regions)
+  {
+    uint64_t sums[kindCount]{};
+    for(size_t component{}; component < componentCount; ++component)
+      for(size_t kind{}; kind < kindCount; ++kind)
+        for(size_t line{region.range.first / lineSize}; line <= region.range.second / lineSize; ++line)
+          sums[kind] += counter(component, kind, line);
+    out << std::left << std::setw(10) << region.name << std::right << std::setw(14) << sums[read] << std::setw(14)
+        << sums[write] << '\n';
+  }
+
+  //counter indices of the hottest lines
+  std::vector<size_t> hottest{};
+  for(size_t i{}; i < counterCount; ++i)
+    if(totals[i]) hottest.push_back(i);
+  const size_t shown{std::min(hottestLines, hottest.size())};
+  std::partial_sort(hottest.begin(), hottest.begin() + shown, hottest.end(),
+                    [&totals](size_t left, size_t right) { return totals[left] > totals[right]; });
+
+  out << "\nhottest lines\n";
+  for(size_t i{}; i < shown; ++i)
+  {
+    const size_t index{hottest[i]};
+    const size_t line{index % lineCount};
+    const size_t kind{(index / lineCount) % kindCount};
+    const size_t component{index / lineCount / kindCount};
+    out << "  " << std::hex << std::setfill('0') << std::setw(4) << line * lineSize << std::dec << std::setfill(' ')
+        << ' ' << std::left << std::setw(7) << componentNames[component] << std::setw(6) << kindNames[kind] << std::right
+        << std::setw(14) << totals[index];
+    if(frames > 0) out << "  " << totals[index] / frames << "/frame";
+    out << '\n';
+  }
+  return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "type_alias.h"
+#include <filesystem>
+#include <fstream>
+#include <iosfwd>
+#include <vector>
+
+//memory access counters per 16 byte line, access kind and mmu component. the mmu only counts in builds with the
+//BBOY_HEATMAP option, the dumps and the report work in any build
+class Heatmap
+{
+public:
+  enum Kind
+  {
+    read,
+    write,
+    kindCount,
+  };
+
+  static constexpr uint32 lineSize{16};
+  static constexpr uint32 lineCount{0x10000 / lineSize};
+  static constexpr uint32 componentCount{4}; //MMU::Component
+
+  Heatmap();
+
+  void count(const size_t component, const Kind kind, const uint16 addr)
+  {
+    ++m_counts[(component * kindCount + kind) * lineCount + addr / lineSize];
+  }
+  void clear(const uint64_t cycle); //counting starts over from the given master cycle
+  void endFrame(const uint64_t cycle); //with a frame dump open the frame is appended to it and the counters cleared
+  bool startFrameDump(const std::filesystem::path& path);
+  bool save(const std::filesystem::path& path, const uint64_t cycle) const; //everything counted since the last clear
+
+  //sums the records of a dump and prints the totals per component and memory region plus the hottest lines
+  static bool report(const std::filesystem::path& path, std::ostream& out, const size_t hottestLines = 16);
+
+private:
+  //a dump is a header followed by records of the first cycle, the cycle count and the counters
+  static constexpr uint32 dumpMagic{0x4D484242}; //"BBHM" as little endian bytes
+  static constexpr uint32 dumpVersion{1};
+  static void writeHeader(std::ostream& file);
+  void writeRecord(std::ostream& file, const uint64_t cycle) const;
+
+  std::vector<uint64_t> m_counts;
+  uint64_t m_startCycle;
+  std::ofstream m_frameDump;
+};
@@ -1,9 +1,11 @@
 #include "core/input.h"
+#include "core/save_state.h"
 #include <SDL3/SDL.h>
 
-Input::Input()
+Input::Input(bool keyboard)
   : m_p1{0xCF}
-  , m_inputBuffer{SDL_GetKeyboardState(0)}
+  , m_buttons{}
+  , m_inputBuffer{keyboard ? SDL_GetKeyboardState(0) : nullptr}
 {
 }
 
@@ -12,6 +14,13 @@ uint8 Input::read() const
   constexpr uint8 SELECT_BUTTONS{0b10'0000};
   constexpr uint8 SELECT_DPAD{0b1'0000};
 
+  if(!m_inputBuffer)
+  {
+    if(!(m_p1 & SELECT_BUTTONS)) return ~m_buttons & 0xF;
+    else if(!(m_p1 & SELECT_DPAD)) return (~m_buttons >> 4) & 0xF;
+    else return 0b1111;
+  }
+
   if(!(m_p1 & SELECT_BUTTONS))
   {
     return (((!m_inputBuffer[SDL_SCANCODE_A]) << 3) | ((!m_inputBuffer[SDL_SCANCODE_S]) << 2) |
@@ -29,3 +38,25 @@ void Input::write(const uint8 value)
 {
   m_p1 = (m_p1 & 0b1100'1111) | (value & 0b0011'0000); //every bit except 4 and 5 are read-only
 }
+
+void Input::setButtons(const uint8 pressed)
+{
+  m_buttons = pressed;
+}
+
+void Input::setKeyboard(const bool keyboard)
+{
+  m_inputBuffer = keyboard ? SDL_GetKeyboardState(0) : nullptr;
+}
+
+void Input::saveState(StateWriter& state) const
+{
+  state.write(m_p1);
+  state.write(m_buttons);
+}
+
+void Input::loadState(StateReader& state)
+{
+  state.read(m_p1);
+  state.read(m_buttons);
+}
@@ -1,15 +1,35 @@
 #pragma once
 #include "type_alias.h"
 
+class StateWriter;
+class StateReader;
 class Input
 {
 public:
-  Input();
+  Input(bool keyboard = true); //without keyboard the buttons only come from setButtons
+
+  enum Button : uint8
+  {
+    a = 1 << 0,
+    b = 1 << 1,
+    select = 1 << 2,
+    start = 1 << 3,
+    right = 1 << 4,
+    left = 1 << 5,
+    up = 1 << 6,
+    down = 1 << 7,
+  };
 
   uint8 read() const;
   void write(const uint8 value);
+  void setButtons(const uint8 pressed); //Button flags
+  void setKeyboard(const bool keyboard);
+
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
 
 private:
   uint8 m_p1;
+  uint8 m_buttons;
   const bool* m_inputBuffer;
 };
@@ -0,0 +1,61 @@
+#include "core/input_movie.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool InputMovie::load(const std::filesystem::path& path)
+{
+  std::ifstream file{path};
+  if(file.fail())
+  {
+    std::cerr << "Couldn't open input movie " << path << '\n';
+    return false;
+  }
+
+  m_entries.clear();
+  std::string line{};
+  for(uint32 lineNumber{1}; std::getline(file, line); ++lineNumber)
+  {
+    if(line.empty() || line.front() == '#') continue;
+
+    std::istringstream stream{line};
+    uint32 frame{};
+    std::string buttons{};
+    stream >> frame >> buttons;
+    if(stream.fail() || (!m_entries.empty() && frame < m_entries.back().frame))
+    {
+      std::cerr << "Input movie line " << lineNumber << " not valid\n";
+      return false;
+    }
+
+    try
+    {
+      addEntry(frame, static_cast<uint8>(std::stoul(buttons, nullptr, 0)));
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr << "Input movie line " << lineNumber << " not valid\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+void InputMovie::addEntry(const uint32 frame, const uint8 buttons)
+{
+  m_entries.push_back(Entry{frame, buttons});
+}
+
+uint8 InputMovie::getButtons(const uint32 frame) const
+{
+  //last entry starting at or before the frame
+  auto entry{std::upper_bound(m_entries.begin(), m_entries.end(), frame,
+                              [](uint32 frame, const Entry& entry) { return frame < entry.frame; })};
+  return entry == m_entries.begin() ? 0 : std::prev(entry)->buttons;
+}
+
+bool InputMovie::empty() const
+{
+  return m_entries.empty();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "type_alias.h"
+#include <filesystem>
+#include <vector>
+
+//buttons per frame, loaded from a text file with one "<frame> <Input::Button flags>" entry per line.
+//an entry holds until the next one, lines starting with # are comments
+class InputMovie
+{
+public:
+  bool load(const std::filesystem::path& path);
+  void addEntry(const uint32 frame, const uint8 buttons); //entries must be added in frame order
+  uint8 getButtons(const uint32 frame) const;
+  bool empty() const;
+
+private:
+  struct Entry
+  {
+    uint32 frame{};
+    uint8 buttons{};
+  };
+
+  std::vector<Entry> m_entries;
+};
@@ -1,75 +1,266 @@
 #include "core/mmu.h"
 #include "core/gameboy.h"
+#include "core/save_state.h"
 #include "hardware_registers.h"
+#include <algorithm>
+#include <utility>
 
 MMU::MMU(Gameboy& gb)
   : m_gameboy{gb}
-  , m_memory{}
+  , m_read{}
+  , m_write{}
+  , m_fetch{}
+  , m_readPages{}
+  , m_writePages{}
+  , m_watchPages{}
+  , m_watchpoints{}
+  , m_nextWatchId{1}
+  , m_watchCallback{}
+#ifdef BBOY_HEATMAP
+  , m_heatmap{}
+#endif
+  , m_busBlocking{true}
+  , m_ppuVramLock{}
+  , m_ramSeed{}
+  , m_vram{}
+  , m_workRam{}
+  , m_oam{}
+  , m_ioPage{}
   , m_cartridgeSlot{}
-  , m_externalBusBlocked{}
-  , m_vramBusBlocked{}
-  , m_dmaTransferCurrentAddress{}
-  , m_dmaTransferInProcess{}
-  , m_dmaTransferEnableDelay{}
+  , m_dma{}
+  , m_pendingDma{}
+  , m_dmaCopied{}
+  , m_dmaWindow{}
 {
+  bindHandlers<Accuracy::accurate>();
   reset();
 }
 
 void MMU::reset()
 {
-  constexpr unsigned int kb64{0x10000};
-  m_memory.resize(kb64);
-  std::fill(m_memory.begin(), m_memory.end(), 0);
+  m_vram.fill(0);
+  m_workRam.fill(0);
+  m_oam.fill(0);
+  m_ioPage.fill(0);
+  if(m_ramSeed)
+  {
+    //splitmix64, the same seed gives the same ram on every host
+    uint64_t state{*m_ramSeed};
+    auto next{[&state]
+    {
+      uint64_t z{state += 0x9E3779B97F4A7C15};
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+      return static_cast<uint8>(z ^ (z >> 31));
+    }};
+    using namespace MemoryRegions;
+    for(uint8& byte : m_workRam) byte = next();
+    for(int addr{highRam.first}; addr <= highRam.second; ++addr) memory(addr) = next();
+  }
   m_cartridgeSlot.reset();
-  m_externalBusBlocked = false;
-  m_vramBusBlocked = false;
-  m_dmaTransferCurrentAddress = 0;
-  m_dmaTransferInProcess = false;
-  m_dmaTransferEnableDelay = 0;
-  m_memory[hardwareReg::IF] = 0xE1;
-  m_memory[hardwareReg::IE] = 0xE0;
-  m_memory[hardwareReg::DMA] = 0xFF;
-  m_memory[hardwareReg::BANK] = 1;
+#ifdef BBOY_HEATMAP
+  m_heatmap.clear(0); //the master clock starts over with a reset
+#endif
+  m_dma = {};
+  m_pendingDma = {};
+  m_dmaCopied = 0;
+  m_dmaWindow = false;
+  memory(hardwareReg::IF) = 0xE1;
+  memory(hardwareReg::IE) = 0xE0;
+  memory(hardwareReg::DMA) = 0xFF;
+  memory(hardwareReg::BANK) = 1;
+
+  m_readPages.fill(nullptr);
+  m_writePages.fill(nullptr);
+  m_ppuVramLock = false;
+  mapMemory();
+}
+
+void MMU::setRamSeed(const std::optional<uint64_t> seed)
+{
+  m_ramSeed = seed;
+}
+
+void MMU::setAccuracy(const Accuracy accuracy)
+{
+  if(accuracy == Accuracy::fast) bindHandlers<Accuracy::fast>();
+  else bindHandlers<Accuracy::accurate>();
+  m_busBlocking = accuracy == Accuracy::accurate;
+  mapMemory();
+}
+
+template<MMU::Component component>
+uint64_t MMU::dmaCycle() const
+{
+  //the cpu runs before the dma step of its cycle, everything else after it
+  return component == Component::cpu ? m_gameboy.m_cycle - 1 : m_gameboy.m_cycle;
 }
 
-void MMU::handleDmaTransfer()
+void MMU::startDma(const uint8 value, const uint64_t cycle)
 {
-  if(m_dmaTransferEnableDelay > 0)
+  if(m_dmaWindow) updateDma(cycle); //a running transfer keeps copying until the new one starts
+  //the first byte is copied two dma steps after the register write, a write during that delay replaces the transfer
+  const uint16 source{static_cast<uint16>(value >= 0xFE ? 0xDE00 + ((value - 0xFE) << 8) : value << 8)};
+  m_pendingDma = {cycle + 2, source, true};
+  if(!m_dmaWindow)
   {
-    if(--m_dmaTransferEnableDelay == 0)
-    {
-      m_dmaTransferInProcess = true;
-      m_dmaTransferCurrentAddress = m_memory[hardwareReg::DMA] >= 0xFE
-                                      ? (0xDE00 + ((m_memory[hardwareReg::DMA] - 0xFE) << 8))
-                                      : (m_memory[hardwareReg::DMA] << 8);
-    }
+    m_dmaWindow = true;
+    mapMemory();
   }
+}
 
-  if((m_dmaTransferCurrentAddress & 0xFF) == 0xA0)
+bool MMU::updateDma(const uint64_t cycle)
+{
+  if(m_pendingDma.scheduled && m_pendingDma.startCycle <= cycle)
   {
-    m_externalBusBlocked = false;
-    m_vramBusBlocked = false;
-    m_dmaTransferInProcess = false;
-    m_dmaTransferCurrentAddress = 0;
+    copyDma(m_pendingDma.startCycle - 1); //a restart cuts the running transfer short
+    m_dma = m_pendingDma;
+    m_dmaCopied = 0;
+    m_pendingDma.scheduled = false;
   }
+  copyDma(cycle);
 
-  if(m_dmaTransferInProcess)
+  const bool inProcess{m_dma.scheduled && cycle < m_dma.startCycle + oamSize};
+  if(!inProcess && !m_pendingDma.scheduled)
   {
-    const uint16 destinationAddr{static_cast<uint16>(0xFE00 | m_dmaTransferCurrentAddress & 0xFF)};
-    write(destinationAddr, read(m_dmaTransferCurrentAddress++, Component::bus), Component::bus);
+    m_dmaWindow = false;
+    mapMemory();
+  }
+  return inProcess;
+}
 
-    using namespace MemoryRegions;
-    m_vramBusBlocked = m_dmaTransferCurrentAddress >= vram.first && m_dmaTransferCurrentAddress <= vram.second;
-    m_externalBusBlocked = isInExternalBus(m_dmaTransferCurrentAddress);
+void MMU::copyDma(const uint64_t cycle)
+{
+  if(!m_dma.scheduled || cycle < m_dma.startCycle) return;
+  const uint64_t due{std::min<uint64_t>(cycle - m_dma.startCycle + 1, oamSize)};
+  using namespace MemoryRegions;
+  for(; m_dmaCopied < due; ++m_dmaCopied)
+  {
+    //the transfer reads like the bus component, without any blocking
+    const uint16 addr{static_cast<uint16>(m_dma.source + m_dmaCopied)};
+#ifdef BBOY_HEATMAP
+    m_heatmap.count(static_cast<size_t>(Component::bus), Heatmap::read, addr);
+    m_heatmap.count(static_cast<size_t>(Component::bus), Heatmap::write, MemoryRegions::oam.first + m_dmaCopied);
+#endif
+    if(addr <= romBank1.second) m_oam[m_dmaCopied] = m_cartridgeSlot.readRom(addr);
+    else if(addr >= externalRam.first && addr <= externalRam.second) m_oam[m_dmaCopied] = m_cartridgeSlot.readRam(addr);
+    else m_oam[m_dmaCopied] = memory(addr);
   }
 }
 
+//only called while the transfer is in process, a source in vram blocks vram and anything else the external bus
+bool MMU::dmaBlocks(const uint16 addr) const
+{
+  using namespace MemoryRegions;
+  auto inVram{[](const uint16 address) { return address >= vram.first && address <= vram.second; }};
+  if(addr >= oam.first && addr <= oam.second) return true;
+  if(inVram(m_dma.source)) return inVram(addr);
+  return isInExternalBus(addr);
+}
+
+bool MMU::ppuVramBlocked()
+{
+  using namespace MemoryRegions;
+  return m_busBlocking && updateDma(m_gameboy.m_cycle) && m_dma.source >= vram.first && m_dma.source <= vram.second;
+}
+
+void MMU::requestInterrupt(const uint8 interrupt)
+{
+  memory(hardwareReg::IF) |= 0b1110'0000 | interrupt; //same as reading IF and writing it back with the bit set
+}
+
+void MMU::mapCartridge()
+{
+  using namespace MemoryRegions;
+  constexpr int pageSize{0x100};
+  for(int addr{romBank0.first}; addr <= romBank1.second; addr += pageSize)
+    mapPage(addr >> 8, m_cartridgeSlot.getRomPage(addr), nullptr);
+  for(int addr{externalRam.first}; addr <= externalRam.second; addr += pageSize)
+  {
+    uint8* writePage{m_dmaWindow ? nullptr : m_cartridgeSlot.getRamWritePage(addr)};
+    mapPage(addr >> 8, m_cartridgeSlot.getRamPage(addr), writePage);
+  }
+}
+
+void MMU::setPpuVramLock(const bool locked)
+{
+  if(locked == m_ppuVramLock) return;
+  m_ppuVramLock = locked;
+  mapVram();
+}
+
+void MMU::mapPage(const int page, const uint8* readBase, uint8* writeBase)
+{
+  //watched pages stay on the handlers, execute watchpoints too since fetches share the read pages
+  m_readPages[page] = m_watchPages[page] & (watchRead | watchExecute) ? nullptr : readBase;
+  m_writePages[page] = m_watchPages[page] & watchWrite ? nullptr : writeBase;
+}
+
+void MMU::mapPages(const std::pair<uint16, uint16> region, const uint8* readBase, uint8* writeBase)
+{
+  for(int page{region.first >> 8}; page <= region.second >> 8; ++page)
+  {
+    const int offset{(page << 8) - region.first};
+    mapPage(page, readBase ? readBase + offset : nullptr, writeBase ? writeBase + offset : nullptr);
+  }
+}
+
+void MMU::mapMemory()
+{
+  mapVram();
+  mapWorkRam();
+  mapCartridge();
+}
+
+//vram and work ram are the only directly mapped regions the accurate profile can block, so they are unmapped while
+//a block could apply and the handlers decide per component. during a dma window nothing is mapped for writing
+void MMU::mapVram()
+{
+  const bool readable{!(m_busBlocking && (m_ppuVramLock || m_dmaWindow))};
+  uint8* base{readable ? m_vram.data() : nullptr};
+  mapPages(MemoryRegions::vram, base, m_dmaWindow ? nullptr : base);
+}
+
+void MMU::mapWorkRam()
+{
+  using namespace MemoryRegions;
+  uint8* writeBase{m_dmaWindow ? nullptr : m_workRam.data()};
+  mapPages({workRam0.first, workRam1.second}, m_busBlocking && m_dmaWindow ? nullptr : m_workRam.data(), writeBase);
+  mapPages(echoRam, m_workRam.data(), writeBase); //echo ram is never blocked
+}
+
 CartridgeSlot& MMU::getCartridgeSlot()
 {
   return m_cartridgeSlot;
 }
 
-uint8 MMU::read(const uint16 addr, const Component component) const
+template<Accuracy profile>
+void MMU::bindHandlers()
+{
+  m_read = {&MMU::watchedRead<profile, watchRead>, &MMU::readImpl<profile, Component::ppu>,
+            &MMU::readImpl<profile, Component::bus>, &MMU::readImpl<profile, Component::timers>};
+  m_write = {&MMU::watchedWrite<profile>, &MMU::writeImpl<profile, Component::ppu>,
+             &MMU::writeImpl<profile, Component::bus>, &MMU::writeImpl<profile, Component::timers>};
+  m_fetch = &MMU::watchedRead<profile, watchExecute>;
+}
+
+template<Accuracy profile, MMU::WatchAccess access>
+uint8 MMU::watchedRead(const uint16 addr)
+{
+  const uint8 value{readImpl<profile, Component::cpu>(addr)};
+  if(m_watchPages[addr >> 8] & access) hitWatchpoints(addr, access, value);
+  return value;
+}
+
+template<Accuracy profile>
+void MMU::watchedWrite(const uint16 addr, const uint8 value)
+{
+  if(m_watchPages[addr >> 8] & watchWrite) hitWatchpoints(addr, watchWrite, value);
+  writeImpl<profile, Component::cpu>(addr, value);
+}
+
+template<Accuracy profile, MMU::Component component>
+uint8 MMU::readImpl(const uint16 addr)
 {
   using namespace MemoryRegions;
   using namespace hardwareReg;
@@ -81,7 +272,7 @@ uint8 MMU::read(const uint16 addr, const Component component) const
   case TIMA:           return m_gameboy.m_timers.getTima();
   case TMA:            return m_gameboy.m_timers.getTma();
   case TAC:            return m_gameboy.m_timers.getTac();
-  case IF:             return m_memory[IF] | 0b1110'0000;
+  case IF:             return memory(IF) | 0b1110'0000;
   case CH1_SW:         return m_gameboy.m_apu.read(APU::ch1Sw);
   case CH1_TIM_DUTY:   return m_gameboy.m_apu.read(APU::ch1TimDuty);
   case CH1_VOL_ENV:    return m_gameboy.m_apu.read(APU::ch1VolEnv);
@@ -125,13 +316,13 @@ uint8 MMU::read(const uint16 addr, const Component component) const
   case SCX:            return m_gameboy.m_ppu.read(PPU::scx);
   case LY:             return m_gameboy.m_ppu.read(PPU::ly);
   case LYC:            return m_gameboy.m_ppu.read(PPU::lyc);
-  case DMA:            return m_memory[DMA];
+  case DMA:            return memory(DMA);
   case BGP:            return m_gameboy.m_ppu.read(PPU::bgp);
   case OBP0:           return m_gameboy.m_ppu.read(PPU::obp0);
   case OBP1:           return m_gameboy.m_ppu.read(PPU::obp1);
   case WY:             return m_gameboy.m_ppu.read(PPU::wy);
   case WX:             return m_gameboy.m_ppu.read(PPU::wx);
-  case IE:             return m_memory[IE] | 0b1110'0000;
+  case IE:             return memory(IE) | 0b1110'0000;
   case BANK:
   case KEY0:
   case KEY1:
@@ -154,25 +345,31 @@ uint8 MMU::read(const uint16 addr, const Component component) const
   {
     if(addr <= romBank1.second) return m_cartridgeSlot.readRom(addr);
     else if(addr >= externalRam.first && addr <= externalRam.second) return m_cartridgeSlot.readRam(addr);
-    else if(addr >= echoRam.first && addr <= echoRam.second) return m_memory[addr - echoRamOffset];
+    else if(addr >= echoRam.first && addr <= echoRam.second) return memory(addr);
 
-    const bool addrInOam{addr >= oam.first && addr <= oam.second};
-    const bool addrInVram{addr >= vram.first && addr <= vram.second};
-    if(m_dmaTransferInProcess && component != Component::bus &&
-       (addrInOam || (m_vramBusBlocked && addrInVram) || (m_externalBusBlocked && isInExternalBus(addr))))
-      return 0xFF;
+    //oam and the regions a transfer blocks are never mapped during a dma window
+    [[maybe_unused]] const bool dmaInProcess{m_dmaWindow && updateDma(dmaCycle<component>())};
+    if constexpr(AccuracyProfile<profile>::busBlocking && component != Component::bus)
+    {
+      const bool addrInOam{addr >= oam.first && addr <= oam.second};
+      const bool addrInVram{addr >= vram.first && addr <= vram.second};
+      if(dmaInProcess && dmaBlocks(addr)) return 0xFF;
 
-    const PPU::Mode ppuMode{m_gameboy.m_ppu.getMode()};
-    if(component == Component::cpu &&
-       ((addrInOam && (ppuMode == PPU::oamScan || ppuMode == PPU::drawing)) || (addrInVram && ppuMode == PPU::drawing)))
-      return 0xFF;
+      if constexpr(component == Component::cpu)
+      {
+        const PPU::Mode ppuMode{m_gameboy.m_ppu.getMode()};
+        if((addrInOam && (ppuMode == PPU::oamScan || ppuMode == PPU::drawing)) || (addrInVram && ppuMode == PPU::drawing))
+          return 0xFF;
+      }
+    }
 
-    return m_memory[addr];
+    return memory(addr);
   }
   }
 }
 
-void MMU::write(const uint16 addr, const uint8 value, const Component component)
+template<Accuracy profile, MMU::Component component>
+void MMU::writeImpl(const uint16 addr, const uint8 value)
 {
   using namespace MemoryRegions;
   using namespace hardwareReg;
@@ -183,7 +380,7 @@ void MMU::write(const uint16 addr, const uint8 value, const Component component)
   case TIMA:           m_gameboy.m_timers.setTima(value); break;
   case TMA:            m_gameboy.m_timers.setTma(value); break;
   case TAC:            m_gameboy.m_timers.setTac(value); break;
-  case IF:             m_memory[IF] = value; break;
+  case IF:             memory(IF) = value; break;
   case CH1_SW:         m_gameboy.m_apu.write(APU::ch1Sw, value); break;
   case CH1_TIM_DUTY:   m_gameboy.m_apu.write(APU::ch1TimDuty, value); break;
   case CH1_VOL_ENV:    m_gameboy.m_apu.write(APU::ch1VolEnv, value); break;
@@ -228,18 +425,15 @@ void MMU::write(const uint16 addr, const uint8 value, const Component component)
   case LY:             m_gameboy.m_ppu.write(PPU::ly, value); break;
   case LYC:            m_gameboy.m_ppu.write(PPU::lyc, value); break;
   case DMA:
-  {
-    m_memory[DMA] = value;
-    constexpr int dmaTransferEnableDelay = 2;
-    m_dmaTransferEnableDelay = dmaTransferEnableDelay;
-  }
-  break;
+    memory(DMA) = value;
+    startDma(value, dmaCycle<component>());
+    break;
   case BGP:   m_gameboy.m_ppu.write(PPU::bgp, value); break;
   case OBP0:  m_gameboy.m_ppu.write(PPU::obp0, value); break;
   case OBP1:  m_gameboy.m_ppu.write(PPU::obp1, value); break;
   case WY:    m_gameboy.m_ppu.write(PPU::wy, value); break;
   case WX:    m_gameboy.m_ppu.write(PPU::wx, value); break;
-  case IE:    m_memory[IE] = value; break;
+  case IE:    memory(IE) = value; break;
   case BANK:
   case KEY0:
   case KEY1:
@@ -260,9 +454,12 @@ void MMU::write(const uint16 addr, const uint8 value, const Component component)
   case PCM34: return;
   default:
   {
+    //every write lands here during a dma window, so the transfer copies its source before anything changes it
+    [[maybe_unused]] const bool dmaInProcess{m_dmaWindow && updateDma(dmaCycle<component>())};
     if(addr <= romBank1.second)
     {
       m_cartridgeSlot.writeRom(addr, value);
+      mapCartridge(); //any rom write can switch banks
       return;
     }
     else if(addr >= externalRam.first && addr <= externalRam.second)
@@ -272,39 +469,173 @@ void MMU::write(const uint16 addr, const uint8 value, const Component component)
     }
     else if(addr >= echoRam.first && addr <= echoRam.second)
     {
-      m_memory[addr - echoRamOffset] = value;
+      memory(addr) = value;
       return;
     }
 
-    const bool addrInOam{addr >= oam.first && addr <= oam.second};
-    const bool addrInVram{addr >= vram.first && addr <= vram.second};
-    if(m_dmaTransferInProcess && component != Component::bus &&
-       (addrInOam || (m_vramBusBlocked && addrInVram) || (m_externalBusBlocked && isInExternalBus(addr))))
-      return;
+    if constexpr(AccuracyProfile<profile>::busBlocking && component != Component::bus)
+    {
+      const bool addrInOam{addr >= oam.first && addr <= oam.second};
+      const bool addrInVram{addr >= vram.first && addr <= vram.second};
+      if(dmaInProcess && dmaBlocks(addr)) return;
 
-    const PPU::Mode ppuMode{m_gameboy.m_ppu.getMode()};
-    if(component == Component::cpu &&
-       ((addrInOam && (ppuMode == PPU::oamScan || ppuMode == PPU::drawing)) || (addrInVram && ppuMode == PPU::drawing)))
-      return;
+      if constexpr(component == Component::cpu)
+      {
+        const PPU::Mode ppuMode{m_gameboy.m_ppu.getMode()};
+        if((addrInOam && (ppuMode == PPU::oamScan || ppuMode == PPU::drawing)) || (addrInVram && ppuMode == PPU::drawing))
+          return;
+      }
+    }
 
-    m_memory[addr] = value;
+    memory(addr) = value;
     break;
   }
   }
 }
 
-uint16 MMU::currentCycle() const
+uint64_t MMU::currentCycle() const
+{
+  return m_gameboy.m_cycle;
+}
+
+void MMU::fillSprite(uint16 oamAddr, Sprite& sprite)
+{
+  if(m_dmaWindow && updateDma(m_gameboy.m_cycle)) return;
+  const uint8* entry{&m_oam[oamAddr - MemoryRegions::oam.first]};
+#ifdef BBOY_HEATMAP
+  for(uint16 addr{oamAddr}; addr < oamAddr + 4; ++addr)
+    m_heatmap.count(static_cast<size_t>(Component::ppu), Heatmap::read, addr);
+#endif
+  sprite.yPosition = entry[0];
+  sprite.xPosition = entry[1];
+  sprite.tileNumber = entry[2];
+  sprite.flags = entry[3];
+}
+
+uint32 MMU::addWatchpoint(const Watchpoint& watchpoint)
+{
+  m_watchpoints.emplace_back(m_nextWatchId, watchpoint);
+  updateWatchPages();
+  return m_nextWatchId++;
+}
+
+void MMU::removeWatchpoint(const uint32 id)
+{
+  std::erase_if(m_watchpoints, [id](const auto& entry) { return entry.first == id; });
+  updateWatchPages();
+}
+
+void MMU::clearWatchpoints()
+{
+  m_watchpoints.clear();
+  updateWatchPages();
+}
+
+void MMU::setWatchCallback(WatchCallback callback)
+{
+  m_watchCallback = std::move(callback);
+}
+
+void MMU::updateWatchPages()
+{
+  m_watchPages.fill(0);
+  for(const auto& [id, watchpoint] : m_watchpoints)
+  {
+    for(int page{watchpoint.first >> 8}; page <= watchpoint.last >> 8; ++page) m_watchPages[page] |= watchpoint.access;
+  }
+  mapMemory();
+}
+
+void MMU::hitWatchpoints(const uint16 addr, const WatchAccess access, const uint8 value)
+{
+  using namespace MemoryRegions;
+  //by index and copied, the callback may add or remove watchpoints
+  for(size_t i{}; i < m_watchpoints.size(); ++i)
+  {
+    const auto [id, watchpoint]{m_watchpoints[i]};
+    if(!(watchpoint.access & access) || addr < watchpoint.first || addr > watchpoint.last) continue;
+    if(watchpoint.bank >= 0)
+    {
+      if(addr <= romBank1.second && m_cartridgeSlot.getRomBank(addr) != watchpoint.bank) continue;
+      if(addr >= externalRam.first && addr <= externalRam.second && m_cartridgeSlot.getRamBank() != watchpoint.bank)
+        continue;
+    }
+
+    if(m_watchCallback) m_watchCallback({id, addr, access, value, m_gameboy.m_cycle});
+    if(watchpoint.stop) m_gameboy.stopRun();
+  }
+}
+
+#ifdef BBOY_HEATMAP
+Heatmap& MMU::getHeatmap()
+{
+  return m_heatmap;
+}
+#endif
+
+uint8* MMU::getVram()
+{
+  return m_vram.data();
+}
+
+uint8* MMU::getWorkRam()
+{
+  return m_workRam.data();
+}
+
+void MMU::syncDma()
+{
+  if(m_dmaWindow) updateDma(m_gameboy.m_cycle);
+}
+
+uint8* MMU::getOam()
 {
-  return m_gameboy.m_currentCycle;
+  syncDma();
+  return m_oam.data();
 }
 
-void MMU::fillSprite(uint16 oamAddr, Sprite& sprite) const
+uint8* MMU::getHighRam()
 {
-  if(m_dmaTransferInProcess) return;
-  sprite.yPosition = m_memory[oamAddr];
-  sprite.xPosition = m_memory[oamAddr + 1];
-  sprite.tileNumber = m_memory[oamAddr + 2];
-  sprite.flags = m_memory[oamAddr + 3];
+  return &memory(MemoryRegions::highRam.first);
+}
+
+void MMU::saveState(StateWriter& state) const
+{
+  state.write(m_vram);
+  state.write(m_workRam);
+  state.write(m_oam);
+  state.write(m_ioPage);
+  for(const OamDma& dma : {m_dma, m_pendingDma})
+  {
+    state.write(dma.startCycle);
+    state.write(dma.source);
+    state.write(dma.scheduled);
+  }
+  state.write(m_dmaCopied);
+  state.write(m_dmaWindow);
+  m_cartridgeSlot.saveState(state);
+}
+
+bool MMU::loadState(StateReader& state)
+{
+  state.read(m_vram);
+  state.read(m_workRam);
+  state.read(m_oam);
+  state.read(m_ioPage);
+  for(OamDma* dma : {&m_dma, &m_pendingDma})
+  {
+    state.read(dma->startCycle);
+    state.read(dma->source);
+    state.read(dma->scheduled);
+  }
+  state.read(m_dmaCopied);
+  state.read(m_dmaWindow);
+  const bool loaded{m_cartridgeSlot.loadState(state)};
+#ifdef BBOY_HEATMAP
+  m_heatmap.clear(m_gameboy.m_cycle); //the gameboy restores the master clock first
+#endif
+  mapMemory();
+  return loaded;
 }
 
 bool MMU::isInExternalBus(const uint16 addr) const
@@ -316,3 +647,17 @@ bool MMU::isInExternalBus(const uint16 addr) const
   return (addr >= externalBusFirstStart && addr <= externalBusFirstEnd) ||
          (addr >= externalBusSecondStart && addr <= externalBusSecondEnd);
 }
+
+const uint8& MMU::memory(const uint16 addr) const
+{
+  using namespace MemoryRegions;
+  if(addr <= vram.second) return m_vram[addr - vram.first];
+  else if(addr <= echoRam.second) return m_workRam[(addr - workRam0.first) & (workRamSize - 1)];
+  else if(addr <= notUsable.second) return m_oam[addr - oam.first];
+  else return m_ioPage[addr - hardwareRegisters.first];
+}
+
+uint8& MMU::memory(const uint16 addr)
+{
+  return const_cast<uint8&>(std::as_const(*this).memory(addr));
+}
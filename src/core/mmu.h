@@ -1,11 +1,20 @@
 #pragma once
+#include "core/accuracy.h"
 #include "core/cartridge/cartridge_slot.h"
+#ifdef BBOY_HEATMAP
+#include "core/heatmap.h"
+#endif
 #include "core/ppu/ppu.h"
 #include "memory_regions.h"
 #include "type_alias.h"
+#include <array>
+#include <functional>
+#include <optional>
 #include <vector>
 
 class Gameboy;
+class StateWriter;
+class StateReader;
 class MMU
 {
 public:
@@ -17,30 +26,176 @@ public:
     ppu,
     bus,
     timers,
+    count,
   };
 
+  enum WatchAccess : uint8
+  {
+    watchRead = 1 << 0,
+    watchWrite = 1 << 1,
+    watchExecute = 1 << 2, //opcode fetches
+  };
+
+  //only cpu accesses are watched, by the address the cpu used
+  struct Watchpoint
+  {
+    uint16 first{};
+    uint16 last{};
+    uint8 access{watchRead | watchWrite}; //WatchAccess flags
+    int bank{-1}; //rom and external ram ranges only match while this bank is mapped, -1 matches any bank
+    bool stop{};  //the run loop returns after the cycle of the hit
+  };
+
+  struct WatchHit
+  {
+    uint32 id{};
+    uint16 address{};
+    WatchAccess access{};
+    uint8 value{}; //read, written or fetched
+    uint64_t cycle{};
+  };
+  using WatchCallback = std::function<void(const WatchHit&)>;
+
   void reset();
-  void handleDmaTransfer();
+  void setRamSeed(const std::optional<uint64_t> seed); //work and high ram start as seeded noise from the next reset
+  void setAccuracy(const Accuracy accuracy);
+  void mapCartridge(); //after the cartridge in the slot changed
+  void setPpuVramLock(const bool locked); //the ppu is drawing, cpu accesses to vram go through the handlers
 
   CartridgeSlot& getCartridgeSlot();
-  uint8 read(const uint16 addr, const Component component) const;
-  void write(const uint16 addr, const uint8 value, const Component component);
-  uint16 currentCycle() const;
 
-  void fillSprite(uint16 oamAddr, Sprite& sprite) const;
+  //mapped pages are a single pointer add, the rest goes through the handlers of the accuracy profile and component
+  template<Component component> uint8 read(const uint16 addr)
+  {
+#ifdef BBOY_HEATMAP
+    m_heatmap.count(static_cast<size_t>(component), Heatmap::read, addr);
+#endif
+    if(const uint8* page{m_readPages[addr >> 8]}) return page[addr & 0xFF];
+    return (this->*m_read[static_cast<int>(component)])(addr);
+  }
+  uint8 fetch(const uint16 addr) //cpu opcode fetch, a read that only execute watchpoints tell apart
+  {
+#ifdef BBOY_HEATMAP
+    m_heatmap.count(static_cast<size_t>(Component::cpu), Heatmap::read, addr);
+#endif
+    if(const uint8* page{m_readPages[addr >> 8]}) return page[addr & 0xFF];
+    return (this->*m_fetch)(addr);
+  }
+  template<Component component> void write(const uint16 addr, const uint8 value)
+  {
+#ifdef BBOY_HEATMAP
+    m_heatmap.count(static_cast<size_t>(component), Heatmap::write, addr);
+#endif
+    if(uint8* page{m_writePages[addr >> 8]}) page[addr & 0xFF] = value;
+    else (this->*m_write[static_cast<int>(component)])(addr, value);
+  }
+
+  //ppu fetches skip the page table and the io switch, only an oam dma from vram can block them
+  uint8 readVram(const uint16 addr)
+  {
+#ifdef BBOY_HEATMAP
+    m_heatmap.count(static_cast<size_t>(Component::ppu), Heatmap::read, addr);
+#endif
+    return m_dmaWindow && ppuVramBlocked() ? 0xFF : m_vram[addr - MemoryRegions::vram.first];
+  }
+  void requestInterrupt(const uint8 interrupt); //IF bit mask
+  uint64_t currentCycle() const; //master clock
+
+  void fillSprite(uint16 oamAddr, Sprite& sprite);
+
+  //pages holding a watchpoint are never mapped, so only accesses to them pay for the check. kept across resets
+  uint32 addWatchpoint(const Watchpoint& watchpoint); //returns the id to remove it with
+  void removeWatchpoint(const uint32 id);
+  void clearWatchpoints();
+  void setWatchCallback(WatchCallback callback);
+
+#ifdef BBOY_HEATMAP
+  Heatmap& getHeatmap(); //cleared on reset and state loads
+#endif
+
+  //direct views of the backing memory, stable for the lifetime of the mmu. getOam brings a running dma up to date
+  void syncDma(); //copies what a running dma transferred so far, Gameboy::run calls it before returning
+  uint8* getVram();
+  uint8* getWorkRam();
+  uint8* getOam();
+  uint8* getHighRam();
+
+  void saveState(StateWriter& state) const;
+  bool loadState(StateReader& state);
 
 private:
+  using ReadHandler = uint8 (MMU::*)(const uint16);
+  using WriteHandler = void (MMU::*)(const uint16, const uint8);
+  static constexpr size_t componentCount{static_cast<size_t>(Component::count)};
+#ifdef BBOY_HEATMAP
+  static_assert(componentCount == Heatmap::componentCount);
+#endif
+
+  template<Accuracy profile> void bindHandlers();
+  template<Accuracy profile, Component component> uint8 readImpl(const uint16 addr);
+  template<Accuracy profile, Component component> void writeImpl(const uint16 addr, const uint8 value);
+  template<Accuracy profile, WatchAccess access> uint8 watchedRead(const uint16 addr);
+  template<Accuracy profile> void watchedWrite(const uint16 addr, const uint8 value);
+  void hitWatchpoints(const uint16 addr, const WatchAccess access, const uint8 value);
+  void updateWatchPages();
   bool isInExternalBus(const uint16 addr) const;
+  const uint8& memory(const uint16 addr) const; //backing byte of any address outside the cartridge
+  uint8& memory(const uint16 addr);
+  void mapPage(const int page, const uint8* readBase, uint8* writeBase);
+  void mapPages(const std::pair<uint16, uint16> region, const uint8* readBase, uint8* writeBase);
+  void mapMemory();
+  void mapVram();
+  void mapWorkRam();
+
+  //the oam dma copies a byte per cycle in its dma step, which runs right after the cpu. instead of stepping it every
+  //cycle the transfer is recorded and copied in bulk up to the current cycle whenever something could observe or
+  //change the bytes involved, so oam ends up exactly as with the per byte copy
+  struct OamDma
+  {
+    uint64_t startCycle; //cycle copying the first byte
+    uint16 source;       //0xFE and 0xFF are already remapped to work ram
+    bool scheduled;
+  };
+  template<Component component> uint64_t dmaCycle() const; //last cycle whose dma step the component can see
+  void startDma(const uint8 value, const uint64_t cycle);
+  bool updateDma(const uint64_t cycle); //true while the transfer blocks the bus after the dma step of cycle
+  void copyDma(const uint64_t cycle);
+  bool dmaBlocks(const uint16 addr) const;
+  bool ppuVramBlocked();
 
-  static constexpr int echoRamOffset{MemoryRegions::echoRam.first - MemoryRegions::workRam0.first};
+  static constexpr size_t vramSize{MemoryRegions::vram.second - MemoryRegions::vram.first + 1};
+  static constexpr size_t workRamSize{MemoryRegions::workRam1.second - MemoryRegions::workRam0.first + 1};
+  static constexpr size_t oamSize{MemoryRegions::oam.second - MemoryRegions::oam.first + 1}; //one dma byte per cycle
+  static constexpr size_t pageSize{0x100};
 
   Gameboy& m_gameboy;
-  std::vector<uint8> m_memory;
+  std::array<ReadHandler, componentCount> m_read;
+  std::array<WriteHandler, componentCount> m_write;
+  ReadHandler m_fetch;
+  //one entry per 256 byte page pointing at the page start, nullptr when the page needs a handler
+  std::array<const uint8*, 0x100> m_readPages;
+  std::array<uint8*, 0x100> m_writePages;
+  std::array<uint8, 0x100> m_watchPages; //WatchAccess flags of the watchpoints touching each page
+  std::vector<std::pair<uint32, Watchpoint>> m_watchpoints;
+  uint32 m_nextWatchId;
+  WatchCallback m_watchCallback;
+#ifdef BBOY_HEATMAP
+  Heatmap m_heatmap;
+#endif
+  bool m_busBlocking;
+  bool m_ppuVramLock;
+  std::optional<uint64_t> m_ramSeed;
+  //only the regions the mmu backs itself, the cartridge owns rom and external ram
+  std::array<uint8, vramSize> m_vram;
+  std::array<uint8, workRamSize> m_workRam; //echo ram mirrors it
+  std::array<uint8, pageSize> m_oam;        //oam followed by the unusable area
+  std::array<uint8, pageSize> m_ioPage;     //io registers the mmu keeps itself, high ram and IE
   CartridgeSlot m_cartridgeSlot;
 
-  bool m_externalBusBlocked;
-  bool m_vramBusBlocked;
-  uint16 m_dmaTransferCurrentAddress;
-  bool m_dmaTransferInProcess;
-  uint8 m_dmaTransferEnableDelay;
+  OamDma m_dma;        //the transfer copying or last copied
+  OamDma m_pendingDma; //a restart still waiting for its start cycle
+  uint8 m_dmaCopied;   //bytes of m_dma already in oam
+  //from the dma register write until the transfer is fully copied and done blocking: every write and the reads
+  //the dma could block go through the handlers, which update the transfer first
+  bool m_dmaWindow;
 };
@@ -1,5 +1,6 @@
 #include "pixel_fetcher.h"
 #include "core/mmu.h"
+#include "core/save_state.h"
 #include "ppu.h"
 
 PixelFetcher::PixelFetcher(PPU& ppu)
@@ -50,6 +51,38 @@ void PixelFetcher::resetEndScanline()
   m_tileAddress = 0;
 }
 
+void PixelFetcher::saveState(StateWriter& state) const
+{
+  state.write(m_isFetchingWindow);
+  state.write(m_firstFetchCompleted);
+  state.write(m_backgroundCycleCounter);
+  state.write(m_spriteFetchDelay);
+  state.write(m_tileX);
+  state.write(m_tilemap);
+  state.write(m_tileNumber);
+  state.write(m_tileDataLow);
+  state.write(m_tileDataHigh);
+  state.write(m_tileAddress);
+  state.write(m_windowLineCounter);
+  state.write(m_wyLyCondition);
+}
+
+void PixelFetcher::loadState(StateReader& state)
+{
+  state.read(m_isFetchingWindow);
+  state.read(m_firstFetchCompleted);
+  state.read(m_backgroundCycleCounter);
+  state.read(m_spriteFetchDelay);
+  state.read(m_tileX);
+  state.read(m_tilemap);
+  state.read(m_tileNumber);
+  state.read(m_tileDataLow);
+  state.read(m_tileDataHigh);
+  state.read(m_tileAddress);
+  state.read(m_windowLineCounter);
+  state.read(m_wyLyCondition);
+}
+
 void PixelFetcher::cycle()
 {
   checkForWindow();
@@ -71,8 +104,8 @@ void PixelFetcher::cycle()
       const uint16 m_tileNumber = tallSprite ? sprite.tileNumber & 0xFE : sprite.tileNumber;
 
       const uint16 tileAddr = 0x8000 + (m_tileNumber * 16) + (2 * row);
-      m_tileDataLow = m_ppu.m_bus.read(tileAddr, MMU::Component::ppu);
-      m_tileDataHigh = m_ppu.m_bus.read(tileAddr + 1, MMU::Component::ppu);
+      m_tileDataLow = m_ppu.m_bus.readVram(tileAddr);
+      m_tileDataHigh = m_ppu.m_bus.readVram(tileAddr + 1);
 
       pushToSpriteFifo(sprite);
       checkForSprite();
@@ -96,7 +129,7 @@ void PixelFetcher::cycle()
                                   (tilesPerRow * ((m_ppu.m_ly + m_ppu.m_scy) / pixelsPerTile))) &
                                  tilemapSize))};
 
-      m_tileNumber = m_ppu.m_bus.read(m_tilemap + offset, MMU::Component::ppu);
+      m_tileNumber = m_ppu.m_bus.readVram(m_tilemap + offset);
     }
     break;
     case fetchTileDataLow:
@@ -106,19 +139,19 @@ void PixelFetcher::cycle()
       {
         m_tileAddress = m_isFetchingWindow ? 0x8000 + (m_tileNumber * 16) + (2 * (m_windowLineCounter & 7))
                                            : 0x8000 + (m_tileNumber * 16) + (2 * ((m_ppu.m_ly + m_ppu.m_scy) & 7));
-        m_tileDataLow = m_ppu.m_bus.read(m_tileAddress, MMU::Component::ppu);
+        m_tileDataLow = m_ppu.m_bus.readVram(m_tileAddress);
       }
       else
       {
         m_tileAddress = m_isFetchingWindow
                           ? 0x9000 + (static_cast<int8>(m_tileNumber) * 16) + (2 * (m_windowLineCounter & 7))
                           : 0x9000 + (static_cast<int8>(m_tileNumber) * 16) + (2 * ((m_ppu.m_ly + m_ppu.m_scy) & 7));
-        m_tileDataLow = m_ppu.m_bus.read(m_tileAddress, MMU::Component::ppu);
+        m_tileDataLow = m_ppu.m_bus.readVram(m_tileAddress);
       }
     }
     break;
     case fetchTileDataHigh:
-      m_tileDataHigh = m_ppu.m_bus.read(m_tileAddress + 1, MMU::Component::ppu);
+      m_tileDataHigh = m_ppu.m_bus.readVram(m_tileAddress + 1);
       if(!m_firstFetchCompleted)
       {
         m_backgroundCycleCounter = 0;
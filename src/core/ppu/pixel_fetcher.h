@@ -3,6 +3,8 @@
 
 class PPU;
 struct Sprite;
+class StateWriter;
+class StateReader;
 class PixelFetcher
 {
 private:
@@ -19,6 +21,8 @@ private:
 
   void reset();
   void resetEndScanline();
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
   void cycle();
   void updateTilemap();
   void checkForWindow();
@@ -1,4 +1,5 @@
 #include "core/mmu.h"
+#include "core/save_state.h"
 #include "hardware_registers.h"
 #include <algorithm>
 #include <iostream>
@@ -11,9 +12,11 @@ PPU::PPU(MMU& mmu, uint16* lcdTexturePtr, PaletteIndex palette)
   , m_palette{palettes[static_cast<int>(palette)]}
   , m_cycleCounter{}
   , m_vblankInterruptNextCycle{}
+  , m_frameReady{}
   , m_reEnabling{}
   , m_reEnableDelay{}
   , m_lcdBuffer{lcdTexturePtr}
+  , m_output{Output::palette}
   , m_xPosition{}
   , m_pixelsToDiscard{}
   , m_spriteBuffer{}
@@ -56,6 +59,7 @@ void PPU::reset()
   m_mode = vBlank;
   m_cycleCounter = 0;
   m_vblankInterruptNextCycle = false;
+  m_frameReady = false;
   m_reEnabling = false;
   m_reEnableDelay = 0;
   for(int i{}; i < lcdWidth * lcdHeight; ++i) m_lcdBuffer[i] = 0;
@@ -75,8 +79,10 @@ void PPU::reset()
   m_obp1 = 0;
   m_wy = 0;
   m_wx = 0;
+  updateVramLock();
 }
 
+template<Accuracy profile>
 void PPU::mCycle()
 {
   if(!(m_lcdc & enableBit)) return;
@@ -91,21 +97,32 @@ void PPU::mCycle()
     m_vblankInterruptNextCycle = false;
   }
 
-  if(m_reEnableDelay > 0)
+  if constexpr(AccuracyProfile<profile>::lcdReEnableDelay)
   {
-    if(--m_reEnableDelay == 0) updateMode(drawing);
-    return;
+    if(m_reEnableDelay > 0)
+    {
+      if(--m_reEnableDelay == 0) updateMode(drawing);
+      updateVramLock();
+      return;
+    }
+    else m_reEnabling = false;
+  }
+  else if(m_reEnabling)
+  {
+    m_reEnableDelay = 0;
+    m_reEnabling = false;
+    updateMode(drawing);
   }
-  else m_reEnabling = false;
 
   ++m_cycleCounter;
   switch(m_mode)
   {
   case oamScan: oamScanCycle(); break;
-  case drawing: drawingCycle(); break;
+  case drawing: drawingCycle<profile>(); break;
   case hBlank:  hBlankCycle(); break;
   case vBlank:  vBlankCycle(); break;
   }
+  updateVramLock();
 }
 
 PPU::Mode PPU::getMode() const
@@ -114,6 +131,83 @@ PPU::Mode PPU::getMode() const
   else return static_cast<Mode>(m_stat & 0b11);
 }
 
+bool PPU::takeFrameReady()
+{
+  const bool frameReady{m_frameReady};
+  m_frameReady = false;
+  return frameReady;
+}
+
+void PPU::setOutput(const Output output)
+{
+  m_output = output;
+}
+
+void PPU::saveState(StateWriter& state) const
+{
+  m_fetcher.saveState(state);
+  state.write(m_statInterrupt.sources);
+  state.write(m_statInterrupt.previousResult);
+  state.write(m_mode);
+  state.write(m_cycleCounter);
+  state.write(m_vblankInterruptNextCycle);
+  state.write(m_reEnabling);
+  state.write(m_reEnableDelay);
+  state.write(m_xPosition);
+  state.write(m_pixelsToDiscard);
+  state.write(m_spriteAddress);
+  state.write(m_lcdc);
+  state.write(m_stat);
+  state.write(m_scy);
+  state.write(m_scx);
+  state.write(m_ly);
+  state.write(m_lyc);
+  state.write(m_bgp);
+  state.write(m_oldBgp);
+  state.write(m_obp0);
+  state.write(m_obp1);
+  state.write(m_wy);
+  state.write(m_wx);
+  state.writeBytes(m_lcdBuffer, lcdWidth * lcdHeight * sizeof(uint16));
+  state.writeContainer(m_spriteBuffer);
+  state.writeContainer(m_pixelFifoBackground);
+  state.writeContainer(m_pixelFifoSprite);
+}
+
+void PPU::loadState(StateReader& state)
+{
+  m_fetcher.loadState(state);
+  state.read(m_statInterrupt.sources);
+  state.read(m_statInterrupt.previousResult);
+  state.read(m_mode);
+  state.read(m_cycleCounter);
+  state.read(m_vblankInterruptNextCycle);
+  state.read(m_reEnabling);
+  state.read(m_reEnableDelay);
+  state.read(m_xPosition);
+  state.read(m_pixelsToDiscard);
+  state.read(m_spriteAddress);
+  state.read(m_lcdc);
+  state.read(m_stat);
+  state.read(m_scy);
+  state.read(m_scx);
+  state.read(m_ly);
+  state.read(m_lyc);
+  state.read(m_bgp);
+  state.read(m_oldBgp);
+  state.read(m_obp0);
+  state.read(m_obp1);
+  state.read(m_wy);
+  state.read(m_wx);
+  state.readBytes(m_lcdBuffer, lcdWidth * lcdHeight * sizeof(uint16));
+  constexpr uint32 spriteBufferMaxSize{10};
+  constexpr uint32 maxFifoSize{16};
+  state.readContainer(m_spriteBuffer, spriteBufferMaxSize);
+  state.readContainer(m_pixelFifoBackground, maxFifoSize);
+  state.readContainer(m_pixelFifoSprite, maxFifoSize);
+  updateVramLock();
+}
+
 uint8 PPU::read(const Index index) const
 {
   switch(index)
@@ -153,6 +247,7 @@ void PPU::write(const Index index, const uint8 value)
       m_cycleCounter = 20;
     }
     m_fetcher.updateTilemap();
+    updateVramLock();
     break;
   case stat:
     m_stat = ((m_stat & 0b111) | (value & ~0b111)) | 0x80;
@@ -204,6 +299,11 @@ void PPU::updateMode(const Mode mode)
   setStatModeSources();
 }
 
+void PPU::updateVramLock()
+{
+  m_bus.setPpuVramLock(getMode() == drawing);
+}
+
 void PPU::updateCoincidenceFlag(bool set)
 {
   m_stat = (m_stat & ~0b100) | (set ? ((m_ly == m_lyc) << 2) : 0);
@@ -249,8 +349,16 @@ void PPU::tryAddSpriteToBuffer(const Sprite sprite)
   }
 }
 
+template<Accuracy profile>
 void PPU::drawingCycle()
 {
+  if constexpr(!AccuracyProfile<profile>::pixelFifo)
+  {
+    if(m_xPosition == 0) renderScanline();
+    if(m_cycleCounter >= fastDrawingEndCycle) endScanline();
+    return;
+  }
+
   for(int i{0}; i < 4; ++i)
   {
     m_fetcher.cycle();
@@ -258,16 +366,103 @@ void PPU::drawingCycle()
     m_oldBgp = 0;
     if(m_xPosition == lcdWidth)
     {
-      m_xPosition = 0;
-      m_fetcher.resetEndScanline();
-      clearFifos();
-      m_spriteBuffer.clear();
-      updateMode(hBlank);
+      endScanline();
       break;
     }
   }
 }
 
+void PPU::renderScanline()
+{
+  constexpr uint8 backgroundEnable{0b1};
+  constexpr uint8 spriteEnable{0b10};
+  constexpr uint8 tallSpriteMode{0b100};
+  constexpr uint8 backgroundTilemap{0b1000};
+  constexpr uint8 unsignedTileData{0b1'0000};
+  constexpr uint8 windowEnable{0b10'0000};
+  constexpr uint8 windowTilemap{0b100'0000};
+  const uint8* vram{m_bus.getVram()};
+
+  //offset in vram of the row of the given tile
+  auto tileRowOffset{[this](const uint8 tileNumber, const uint8 row)
+  {
+    return (m_lcdc & unsignedTileData ? tileNumber * 16 : 0x1000 + static_cast<int8>(tileNumber) * 16) + 2 * row;
+  }};
+
+  if(m_wy == m_ly) m_fetcher.m_wyLyCondition = true;
+  const bool window{m_fetcher.m_wyLyCondition && (m_lcdc & windowEnable) && m_wx < lcdWidth + 7};
+  const int windowStart{window ? m_wx - 7 : lcdWidth};
+  if(window) ++m_fetcher.m_windowLineCounter;
+
+  std::array<uint8, lcdWidth> backgroundColors{};
+  for(int x{}; x < lcdWidth; ++x)
+  {
+    const bool inWindow{x >= windowStart};
+    const uint8 pixelX{static_cast<uint8>(inWindow ? x - windowStart : x + m_scx)};
+    const uint8 pixelY{static_cast<uint8>(inWindow ? m_fetcher.m_windowLineCounter : m_ly + m_scy)};
+    const uint16 tilemap{static_cast<uint16>(m_lcdc & (inWindow ? windowTilemap : backgroundTilemap) ? 0x1C00 : 0x1800)};
+
+    const uint8 tileNumber{vram[tilemap + (pixelY / 8) * 32 + pixelX / 8]};
+    const int tileRow{tileRowOffset(tileNumber, pixelY & 7)};
+    const uint8 bit{static_cast<uint8>(7 - (pixelX & 7))};
+    backgroundColors[x] = ((vram[tileRow] >> bit) & 0b1) | (((vram[tileRow + 1] >> bit) & 0b1) << 1);
+  }
+
+  //sprite pixels, the buffer is sorted by descending x so the highest priority sprites come last
+  std::array<Pixel, lcdWidth> spritePixels{};
+  if(m_lcdc & spriteEnable)
+  {
+    const bool tallSprite{static_cast<bool>(m_lcdc & tallSpriteMode)};
+    for(auto sprite{m_spriteBuffer.rbegin()}; sprite != m_spriteBuffer.rend(); ++sprite)
+    {
+      constexpr uint8 yFlipFlag{0b100'0000};
+      constexpr uint8 xFlipFlag{0b10'0000};
+      constexpr uint8 paletteFlag{0b1'0000};
+      constexpr uint8 backgroundPriorityFlag{0x80};
+
+      uint8 row = (m_ly - sprite->yPosition) & (tallSprite ? 15 : 7);
+      if(sprite->flags & yFlipFlag) row ^= tallSprite ? 15 : 7;
+      const int tileRow{(tallSprite ? sprite->tileNumber & 0xFE : sprite->tileNumber) * 16 + 2 * row};
+
+      for(int i{}; i < 8; ++i)
+      {
+        const int x{sprite->xPosition - 8 + i};
+        //same mixing as the sprite fifo, an earlier pixel is only kept if opaque and above the background
+        if(x < 0 || x >= lcdWidth || (spritePixels[x].colorIndex != 0 && !spritePixels[x].backgroundPriority)) continue;
+
+        const uint8 bit{static_cast<uint8>(sprite->flags & xFlipFlag ? i : 7 - i)};
+        spritePixels[x].colorIndex = ((vram[tileRow] >> bit) & 0b1) | (((vram[tileRow + 1] >> bit) & 0b1) << 1);
+        spritePixels[x].spritePalette = sprite->flags & paletteFlag;
+        spritePixels[x].backgroundPriority = sprite->flags & backgroundPriorityFlag;
+      }
+    }
+  }
+
+  for(m_xPosition = 0; m_xPosition < lcdWidth; ++m_xPosition)
+  {
+    const Pixel& sprite{spritePixels[m_xPosition]};
+    const uint8 backgroundColor{backgroundColors[m_xPosition]};
+    if(sprite.colorIndex != 0 && (!sprite.backgroundPriority || backgroundColor == 0))
+      outputPixel(((sprite.spritePalette ? m_obp1 : m_obp0) >> (sprite.colorIndex << 1)) & 0b11);
+    else outputPixel(m_lcdc & backgroundEnable ? (m_bgp >> (backgroundColor << 1)) & 0b11 : 0);
+  }
+}
+
+void PPU::endScanline()
+{
+  m_xPosition = 0;
+  m_fetcher.resetEndScanline();
+  clearFifos();
+  m_spriteBuffer.clear();
+  updateMode(hBlank);
+}
+
+void PPU::outputPixel(const uint8 shade)
+{
+  if(m_output == Output::palette) m_lcdBuffer[m_xPosition + lcdWidth * m_ly] = m_palette[shade];
+  else if(m_output == Output::shade) m_lcdBuffer[m_xPosition + lcdWidth * m_ly] = shade;
+}
+
 void PPU::tryToPushPixel()
 {
   if(!m_pixelFifoBackground.empty() && m_fetcher.m_spriteFetchDelay == 0)
@@ -289,7 +484,7 @@ void PPU::tryToPushPixel()
         pixel.paletteValue |= m_oldBgp;
       }
 
-      m_lcdBuffer[m_xPosition + lcdWidth * m_ly] = m_palette[(pixel.paletteValue >> (pixel.colorIndex << 1)) & 0b11];
+      outputPixel((pixel.paletteValue >> (pixel.colorIndex << 1)) & 0b11);
       ++m_xPosition;
       if(!m_pixelFifoSprite.empty()) m_pixelFifoSprite.pop_front();
     }
@@ -326,6 +521,7 @@ void PPU::hBlankCycle()
                                   // vBlank, vBlank for another 10 scanlines
   {
     m_vblankInterruptNextCycle = true;
+    m_frameReady = true;
     updateMode(vBlank);
     constexpr uint8 statOamSourceEnable{0b10'0000};
     if(m_stat & statOamSourceEnable)
@@ -355,10 +551,13 @@ void PPU::vBlankCycle()
 
 void PPU::requestStatInterrupt() const
 {
-  m_bus.write(hardwareReg::IF, m_bus.read(hardwareReg::IF, MMU::Component::ppu) | 0b10, MMU::Component::ppu);
+  m_bus.requestInterrupt(0b10);
 }
 
 void PPU::requestVBlankInterrupt() const
 {
-  m_bus.write(hardwareReg::IF, m_bus.read(hardwareReg::IF, MMU::Component::ppu) | 0b1, MMU::Component::ppu);
+  m_bus.requestInterrupt(0b1);
 }
+
+template void PPU::mCycle<Accuracy::accurate>();
+template void PPU::mCycle<Accuracy::fast>();
@@ -1,4 +1,5 @@
 #pragma once
+#include "core/accuracy.h"
 #include "core/ppu/pixel_fetcher.h"
 #include "type_alias.h"
 #include <array>
@@ -21,6 +22,8 @@ struct Sprite
 };
 
 class MMU;
+class StateWriter;
+class StateReader;
 class PPU
 {
 public:
@@ -32,6 +35,14 @@ public:
     max
   };
 
+  //what gets written to the lcd buffer for each pixel
+  enum class Output
+  {
+    palette, //rgb565 color from the palette
+    shade,   //raw shade index 0-3, skips the palette conversion
+    none,    //nothing, the frame is only emulated
+  };
+
   PPU(MMU& bus, uint16* lcdTexturePtr, PaletteIndex palette = PaletteIndex::grey);
 
   enum Index
@@ -60,9 +71,14 @@ public:
   static PaletteIndex stringToPaletteIndex(std::string_view paletteString);
 
   void reset();
-  void mCycle();
+  template<Accuracy profile> void mCycle();
 
   PPU::Mode getMode() const;
+  bool takeFrameReady(); //true once each time the ppu enters vblank with a complete frame in the lcd buffer
+  void setOutput(const Output output);
+
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
 
   uint8 read(const Index index) const;
   void write(const Index index, const uint8 value);
@@ -97,12 +113,16 @@ private:
   void setStatModeSources();
 
   void updateMode(const Mode mode);
+  void updateVramLock(); //tells the bus whether cpu vram accesses are blocked
   void updateCoincidenceFlag(bool set = true);
 
   void oamScanCycle();
   void tryAddSpriteToBuffer(const Sprite sprite);
 
-  void drawingCycle();
+  template<Accuracy profile> void drawingCycle();
+  void renderScanline(); //whole line at once, without the fifo timing
+  void endScanline();
+  void outputPixel(const uint8 shade);
   void tryToPushPixel();
   bool shouldPushSpritePixel() const;
   void clearFifos();
@@ -124,6 +144,7 @@ private:
   static constexpr int oamScanEndCycle{20};
   static constexpr uint16 oamMemoryStart{0xFE00};
   static constexpr int scanlineEndCycle{114};
+  static constexpr int fastDrawingEndCycle{oamScanEndCycle + 43}; //mode 3 length without sprites or scrolling
 
   MMU& m_bus;
   PixelFetcher m_fetcher;
@@ -133,10 +154,12 @@ private:
 
   uint8 m_cycleCounter;
   bool m_vblankInterruptNextCycle;
+  bool m_frameReady;
   bool m_reEnabling;
   uint8 m_reEnableDelay;
 
   uint16* m_lcdBuffer;
+  Output m_output;
   uint8 m_xPosition; //x position of the pixel to output
   uint8 m_pixelsToDiscard;
 
@@ -0,0 +1,42 @@
+#include "core/save_state.h"
+
+StateWriter::StateWriter(std::vector<uint8>& buffer)
+  : m_buffer{buffer}
+{
+}
+
+void StateWriter::writeBytes(const void* data, size_t size)
+{
+  const uint8* bytes{static_cast<const uint8*>(data)};
+  m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+StateReader::StateReader(const uint8* data, size_t size)
+  : m_data{data}
+  , m_size{size}
+  , m_offset{}
+  , m_failed{}
+{
+}
+
+void StateReader::readBytes(void* data, size_t size)
+{
+  if(m_failed || size > m_size - m_offset)
+  {
+    m_failed = true;
+    std::memset(data, 0, size);
+    return;
+  }
+  std::memcpy(data, m_data + m_offset, size);
+  m_offset += size;
+}
+
+void StateReader::fail()
+{
+  m_failed = true;
+}
+
+bool StateReader::failed() const
+{
+  return m_failed;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "type_alias.h"
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//binary save state streams, every component writes its fields one by one in declaration order.
+//structs are never written whole so padding bytes can't make two equal states differ
+class StateWriter
+{
+public:
+  StateWriter(std::vector<uint8>& buffer);
+
+  template<typename T>
+  void write(const T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    writeBytes(&value, sizeof(T));
+  }
+
+  template<typename Container>
+  void writeContainer(const Container& container) //for containers of padding free elements
+  {
+    write(static_cast<uint32>(container.size()));
+    for(const auto& element : container) write(element);
+  }
+
+  void writeBytes(const void* data, size_t size);
+
+private:
+  std::vector<uint8>& m_buffer;
+};
+
+class StateReader
+{
+public:
+  StateReader(const uint8* data, size_t size);
+
+  template<typename T>
+  void read(T& value)
+  {
+    static_assert(std::is_trivially_copyable_v<T>);
+    readBytes(&value, sizeof(T));
+  }
+
+  template<typename Container>
+  void readContainer(Container& container, uint32 maxSize)
+  {
+    uint32 size{};
+    read(size);
+    if(size > maxSize) m_failed = true;
+    container.clear();
+    for(uint32 i{}; i < size && !m_failed; ++i)
+    {
+      typename Container::value_type element{};
+      read(element);
+      container.push_back(element);
+    }
+  }
+
+  void readBytes(void* data, size_t size);
+  void fail(); //for values that were read fine but can't be loaded
+  bool failed() const;
+
+private:
+  const uint8* m_data;
+  size_t m_size;
+  size_t m_offset;
+  bool m_failed;
+};
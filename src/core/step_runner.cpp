@@ -0,0 +1,173 @@
+#include "core/step_runner.h"
+#include <cstring>
+
+StepRunner::StepRunner(Gameboy& gameboy)
+  : m_gameboy{gameboy}
+  , m_format{Observation::none}
+  , m_downsample{1}
+  , m_predicates{}
+  , m_observation{}
+{
+}
+
+bool StepRunner::setObservation(const Observation format, const uint8 downsample)
+{
+  if(downsample == 0 || PPU::lcdWidth % downsample != 0 || PPU::lcdHeight % downsample != 0) return false;
+  m_format = format;
+  m_downsample = downsample;
+  m_observation.clear();
+  return true;
+}
+
+void StepRunner::addTerminalPredicate(const TerminalPredicate& predicate)
+{
+  m_predicates.push_back(predicate);
+}
+
+void StepRunner::clearTerminalPredicates()
+{
+  m_predicates.clear();
+}
+
+StepRunner::Result StepRunner::step(const uint8 buttons, const uint32 repeat)
+{
+  if(!m_gameboy.hasRom()) return Result{};
+
+  m_gameboy.setButtons(buttons);
+  if(repeat > 0)
+  {
+    //a frame only returns early when a watchpoint stopped it
+    auto stopped{[&] { return m_gameboy.frameCycle() != 0; }};
+
+    //intermediate frames are only emulated, no pixel is written
+    m_gameboy.setLcdOutput(PPU::Output::none);
+    for(uint32 i{1}; i < repeat; ++i)
+    {
+      m_gameboy.frame();
+      if(stopped())
+      {
+        m_gameboy.setLcdOutput(PPU::Output::palette);
+        return Result{m_observation.data(), m_observation.size(), isTerminal(), true};
+      }
+    }
+
+    const bool shades{m_format == Observation::grayscale || m_format == Observation::packed};
+    m_gameboy.setLcdOutput(shades ? PPU::Output::shade : PPU::Output::palette);
+    m_gameboy.frame();
+    m_gameboy.setLcdOutput(PPU::Output::palette);
+    if(stopped()) return Result{m_observation.data(), m_observation.size(), isTerminal(), true};
+    buildObservation();
+  }
+
+  return Result{m_observation.data(), m_observation.size(), isTerminal()};
+}
+
+uint32 StepRunner::getObservationWidth() const
+{
+  return PPU::lcdWidth / m_downsample;
+}
+
+uint32 StepRunner::getObservationHeight() const
+{
+  return PPU::lcdHeight / m_downsample;
+}
+
+void StepRunner::buildObservation()
+{
+  const uint16* lcd{m_gameboy.getLcdBuffer()};
+  const uint32 width{getObservationWidth()};
+  const uint32 height{getObservationHeight()};
+  const uint32 blockSize{static_cast<uint32>(m_downsample * m_downsample)};
+
+  //sum of the shades in the block starting at the given output pixel
+  auto blockSum{[&](uint32 x, uint32 y)
+  {
+    uint32 sum{};
+    for(uint32 row{}; row < m_downsample; ++row)
+    {
+      const uint16* line{lcd + (y * m_downsample + row) * PPU::lcdWidth + x * m_downsample};
+      for(uint32 column{}; column < m_downsample; ++column) sum += line[column];
+    }
+    return sum;
+  }};
+
+  switch(m_format)
+  {
+  case Observation::none: m_observation.clear(); break;
+  case Observation::rgb565:
+    m_observation.resize(width * height * sizeof(uint16));
+    for(uint32 y{}; y < height; ++y)
+    {
+      for(uint32 x{}; x < width; ++x)
+      {
+        //the channels are averaged separately so they don't carry into each other
+        uint32 red{};
+        uint32 green{};
+        uint32 blue{};
+        for(uint32 row{}; row < m_downsample; ++row)
+        {
+          const uint16* line{lcd + (y * m_downsample + row) * PPU::lcdWidth + x * m_downsample};
+          for(uint32 column{}; column < m_downsample; ++column)
+          {
+            red += line[column] >> 11;
+            green += (line[column] >> 5) & 0x3F;
+            blue += line[column] & 0x1F;
+          }
+        }
+        const uint16 pixel{static_cast<uint16>((red + blockSize / 2) / blockSize << 11 |
+                                               (green + blockSize / 2) / blockSize << 5 |
+                                               (blue + blockSize / 2) / blockSize)};
+        std::memcpy(&m_observation[(y * width + x) * sizeof(uint16)], &pixel, sizeof(uint16));
+      }
+    }
+    break;
+  case Observation::grayscale:
+    m_observation.resize(width * height);
+    for(uint32 y{}; y < height; ++y)
+    {
+      for(uint32 x{}; x < width; ++x)
+      {
+        constexpr uint32 shadeStep{85}; //255 / 3
+        m_observation[y * width + x] = static_cast<uint8>(255 - (blockSum(x, y) * shadeStep + blockSize / 2) / blockSize);
+      }
+    }
+    break;
+  case Observation::packed:
+    m_observation.assign((width * height + 3) / 4, 0);
+    for(uint32 y{}; y < height; ++y)
+    {
+      for(uint32 x{}; x < width; ++x)
+      {
+        const uint32 index{y * width + x};
+        const uint8 shade{static_cast<uint8>((blockSum(x, y) + blockSize / 2) / blockSize)};
+        m_observation[index >> 2] |= shade << ((index & 0b11) << 1);
+      }
+    }
+    break;
+  }
+}
+
+bool StepRunner::isTerminal()
+{
+  for(const TerminalPredicate& predicate : m_predicates)
+  {
+    const uint8 value{
+      static_cast<uint8>(m_gameboy.getBus().read<MMU::Component::bus>(predicate.address) & predicate.mask)};
+    switch(predicate.compare)
+    {
+    case TerminalPredicate::Compare::equal:
+      if(value == predicate.value) return true;
+      break;
+    case TerminalPredicate::Compare::notEqual:
+      if(value != predicate.value) return true;
+      break;
+    case TerminalPredicate::Compare::less:
+      if(value < predicate.value) return true;
+      break;
+    case TerminalPredicate::Compare::greater:
+      if(value > predicate.value) return true;
+      break;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "core/gameboy.h"
+#include "type_alias.h"
+#include <vector>
+
+//reinforcement learning style stepping: holds an action for several frames and only renders the last one
+class StepRunner
+{
+public:
+  enum class Observation
+  {
+    none,
+    rgb565,    //2 bytes per pixel, native endianness
+    grayscale, //1 byte per pixel, 255 is white
+    packed,    //2 bit shades (0 is white), 4 pixels per byte starting from the low bits
+  };
+
+  struct TerminalPredicate
+  {
+    enum class Compare
+    {
+      equal,
+      notEqual,
+      less,
+      greater,
+    };
+
+    uint16 address{};
+    uint8 mask{0xFF};
+    Compare compare{Compare::equal};
+    uint8 value{};
+  };
+
+  struct Result
+  {
+    const uint8* observation{};
+    size_t observationSize{};
+    bool terminal{};
+    bool stopped{}; //a stopping watchpoint hit mid frame, the observation is still the one of the previous step
+  };
+
+  StepRunner(Gameboy& gameboy);
+
+  //downsample must divide both lcd sizes (1, 2, 4, 8 or 16), each output pixel averages a downsample * downsample block
+  bool setObservation(const Observation format, const uint8 downsample = 1);
+  void addTerminalPredicate(const TerminalPredicate& predicate);
+  void clearTerminalPredicates();
+
+  //the predicates are checked once, after the last frame or after a stopping watchpoint ended the step early.
+  //the next step finishes the interrupted frame as its first one
+  Result step(const uint8 buttons, const uint32 repeat = 1);
+
+  uint32 getObservationWidth() const;
+  uint32 getObservationHeight() const;
+
+private:
+  void buildObservation();
+  bool isTerminal();
+
+  Gameboy& m_gameboy;
+  Observation m_format;
+  uint8 m_downsample;
+  std::vector<TerminalPredicate> m_predicates;
+  std::vector<uint8> m_observation;
+};
@@ -1,5 +1,6 @@
 #include "core/timers.h"
 #include "core/mmu.h"
+#include "core/save_state.h"
 #include "hardware_registers.h"
 #include "timers.h"
 
@@ -25,6 +26,26 @@ void Timers::reset()
   m_tac = 0xF8;
 }
 
+void Timers::saveState(StateWriter& state) const
+{
+  state.write(m_timaResetCounter);
+  state.write(m_lastAndResult);
+  state.write(m_div);
+  state.write(m_tima);
+  state.write(m_tma);
+  state.write(m_tac);
+}
+
+void Timers::loadState(StateReader& state)
+{
+  state.read(m_timaResetCounter);
+  state.read(m_lastAndResult);
+  state.read(m_div);
+  state.read(m_tima);
+  state.read(m_tma);
+  state.read(m_tac);
+}
+
 void Timers::mCycle()
 {
   for(int i{}; i < 4; ++i)
@@ -94,6 +115,5 @@ void Timers::setTac(uint8 value)
 
 void Timers::requestTimerInterrupt() const
 {
-  m_bus.write(hardwareReg::IF, m_bus.read(hardwareReg::IF, MMU::Component::timers) | 0b100,
-              MMU::Component::timers); //bit 2 is timer interrupt
+  m_bus.requestInterrupt(0b100); //bit 2 is timer interrupt
 }
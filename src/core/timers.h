@@ -3,6 +3,8 @@
 #include <array>
 
 class MMU;
+class StateWriter;
+class StateReader;
 class Timers
 {
 public:
@@ -11,6 +13,9 @@ public:
   void reset();
   void mCycle();
 
+  void saveState(StateWriter& state) const;
+  void loadState(StateReader& state);
+
   uint8 getDiv() const;
   uint8 getTima() const;
   uint8 getTma() const;
@@ -0,0 +1,195 @@
+#include "diff/diff_runner.h"
+#include "memory_regions.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+uint64_t hashBytes(const uint8* data, size_t size)
+{
+  //fnv-1a
+  uint64_t hash{0xCBF29CE484222325};
+  for(size_t i{}; i < size; ++i) hash = (hash ^ data[i]) * 0x100000001B3;
+  return hash;
+}
+
+size_t regionSize(std::pair<uint16, uint16> region)
+{
+  return region.second - region.first + 1;
+}
+
+std::string registersToString(const CPU::Registers& registers)
+{
+  char text[96]{};
+  std::snprintf(text, sizeof(text), "af %02X%02X bc %02X%02X de %02X%02X hl %02X%02X sp %04X pc %04X ime %d halt %d",
+                registers.a, registers.f, registers.b, registers.c, registers.d, registers.e, registers.h, registers.l,
+                registers.sp, registers.pc, registers.ime, registers.halted);
+  return text;
+}
+} //namespace
+
+DiffRunner::DiffRunner(const Configuration& first, const Configuration& second)
+  : m_configurations{first, second}
+  , m_gameboys{std::make_unique<Gameboy>(nullptr), std::make_unique<Gameboy>(nullptr)}
+  , m_movie{}
+  , m_cycle{}
+  , m_frame{}
+{
+}
+
+bool DiffRunner::openRom(const std::filesystem::path& romPath)
+{
+  for(size_t i{}; i < 2; ++i)
+  {
+    m_gameboys[i]->setDeterministic(true);
+    m_gameboys[i]->openRom(romPath, m_configurations[i].accuracy);
+  }
+  m_cycle = 0;
+  m_frame = 0;
+  return m_gameboys[0]->hasRom() && m_gameboys[1]->hasRom();
+}
+
+void DiffRunner::setMovie(const InputMovie& movie)
+{
+  m_movie = movie;
+}
+
+const DiffRunner::Configuration& DiffRunner::getConfiguration(const size_t index) const
+{
+  return m_configurations[index];
+}
+
+DiffRunner::Divergence DiffRunner::run(const uint32 frames, const uint32 checkpointCycles, const uint8 checks)
+{
+  const uint64_t endFrame{m_frame + frames};
+  std::vector<uint8> checkpoints[2]{};
+  uint64_t checkpointCycle{m_cycle};
+  uint64_t checkpointFrame{m_frame};
+  for(size_t i{}; i < 2; ++i) m_gameboys[i]->saveState(checkpoints[i]);
+
+  while(m_frame < endFrame)
+  {
+    runTo(checkpointCycle + std::max(checkpointCycles, 1u));
+
+    //frames end at vblank, mid frame the profiles may have drawn a different part of the current line
+    std::string description{};
+    if(frameEnded(0) != frameEnded(1))
+      description = "frame ended only on " + m_configurations[frameEnded(0) ? 0 : 1].name;
+    else description = compare(frameEnded(0) ? checks : checks & ~framebuffer);
+    if(description.empty())
+    {
+      checkpointCycle = m_cycle;
+      checkpointFrame = m_frame;
+      for(size_t i{}; i < 2; ++i) m_gameboys[i]->saveState(checkpoints[i]);
+      continue;
+    }
+
+    Divergence divergence{true, false, m_cycle, m_frame, m_gameboys[0]->frameCycle(), {}, description};
+    const uint64_t mismatchCycle{m_cycle};
+
+    //rewind and look for the exact cycle, without the framebuffer for the same reason
+    for(size_t i{}; i < 2; ++i) m_gameboys[i]->loadState(checkpoints[i].data(), checkpoints[i].size());
+    m_cycle = checkpointCycle;
+    m_frame = checkpointFrame;
+    while(m_cycle < mismatchCycle)
+    {
+      runTo(m_cycle + 1);
+      description = compare(checks & ~framebuffer);
+      if(!description.empty())
+      {
+        divergence = Divergence{true, true, m_cycle, m_frame, m_gameboys[0]->frameCycle(), {}, description};
+        break;
+      }
+    }
+
+    for(size_t i{}; i < 2; ++i) divergence.pc[i] = m_gameboys[i]->getCpu().getRegisters().pc;
+    return divergence;
+  }
+  return Divergence{};
+}
+
+void DiffRunner::runTo(const uint64_t cycle)
+{
+  //input changes only when the first side ends a frame so both sides always see the same buttons, and the movie
+  //frames are the frames the game sees
+  while(m_cycle < cycle)
+  {
+    const uint8 buttons{m_movie.getButtons(static_cast<uint32>(m_frame))};
+    m_gameboys[0]->setButtons(buttons);
+    const uint32 ran{m_gameboys[0]->runCycles(static_cast<uint32>(cycle - m_cycle), true)};
+    m_gameboys[1]->setButtons(buttons);
+    m_gameboys[1]->runCycles(ran);
+    m_cycle += ran;
+    if(frameEnded(0))
+    {
+      ++m_frame;
+      return;
+    }
+  }
+}
+
+bool DiffRunner::frameEnded(const size_t index) const
+{
+  return m_gameboys[index]->frameCycle() == 0 && m_cycle != 0;
+}
+
+std::string DiffRunner::compare(const uint8 checks)
+{
+  Gameboy& first{*m_gameboys[0]};
+  Gameboy& second{*m_gameboys[1]};
+
+  if(checks & registers)
+  {
+    const CPU::Registers firstRegisters{first.getCpu().getRegisters()};
+    const CPU::Registers secondRegisters{second.getCpu().getRegisters()};
+    if(firstRegisters != secondRegisters)
+      return "registers: " + registersToString(firstRegisters) + " vs " + registersToString(secondRegisters);
+  }
+
+  if(checks & memory)
+  {
+    using namespace MemoryRegions;
+    struct Region
+    {
+      const char* name;
+      uint8* (MMU::*data)();
+      size_t size;
+    };
+    const Region regions[]{
+      {"vram", &MMU::getVram, regionSize(vram)},
+      {"wram", &MMU::getWorkRam, regionSize({workRam0.first, workRam1.second})},
+      {"oam", &MMU::getOam, regionSize(oam)},
+      {"hram", &MMU::getHighRam, regionSize(highRam)},
+    };
+
+    for(const Region& region : regions)
+    {
+      const uint8* firstData{(first.getBus().*region.data)()};
+      const uint8* secondData{(second.getBus().*region.data)()};
+      if(hashBytes(firstData, region.size) == hashBytes(secondData, region.size)) continue;
+
+      const size_t offset{static_cast<size_t>(std::mismatch(firstData, firstData + region.size, secondData).first - firstData)};
+      char text[64]{};
+      std::snprintf(text, sizeof(text), "%s: first difference at offset %04zX (%02X vs %02X)", region.name, offset,
+                    firstData[offset], secondData[offset]);
+      return text;
+    }
+  }
+
+  if(checks & framebuffer)
+  {
+    const uint16* firstLcd{first.getLcdBuffer()};
+    const uint16* secondLcd{second.getLcdBuffer()};
+    const int pixels{PPU::lcdWidth * PPU::lcdHeight};
+    int different{};
+    for(int i{}; i < pixels; ++i) different += firstLcd[i] != secondLcd[i];
+    if(different > 0)
+    {
+      const int index{static_cast<int>(std::mismatch(firstLcd, firstLcd + pixels, secondLcd).first - firstLcd)};
+      return "framebuffer: " + std::to_string(different) + " pixels differ, first at x " +
+             std::to_string(index % PPU::lcdWidth) + " y " + std::to_string(index / PPU::lcdWidth);
+    }
+  }
+
+  return {};
+}
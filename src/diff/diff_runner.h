@@ -0,0 +1,58 @@
+#pragma once
+#include "core/gameboy.h"
+#include "core/input_movie.h"
+#include "type_alias.h"
+#include <filesystem>
+#include <memory>
+#include <string>
+
+//runs the same rom and input movie on two configurations in lockstep and finds where they stop agreeing
+class DiffRunner
+{
+public:
+  struct Configuration
+  {
+    std::string name{};
+    Accuracy accuracy{Accuracy::accurate};
+  };
+
+  enum Check : uint8
+  {
+    registers = 1 << 0,
+    memory = 1 << 1, //vram, wram, oam and hram hashes
+    framebuffer = 1 << 2,
+    all = registers | memory | framebuffer,
+  };
+
+  struct Divergence
+  {
+    bool found{};
+    bool exact{};     //false when only the framebuffer differs, it's only compared when both sides end a frame
+    uint64_t cycle{}; //m-cycles since the rom was opened
+    uint64_t frame{}; //frames the first side finished before the divergence
+    uint16 frameCycle{};
+    uint16 pc[2]{};
+    std::string description{};
+  };
+
+  DiffRunner(const Configuration& first, const Configuration& second);
+
+  bool openRom(const std::filesystem::path& romPath);
+  void setMovie(const InputMovie& movie);
+  const Configuration& getConfiguration(const size_t index) const;
+
+  //compares at every checkpoint and at the end of every frame, on a mismatch both sides rewind to the last good
+  //comparison and step one m-cycle at a time
+  Divergence run(const uint32 frames, const uint32 checkpointCycles = Gameboy::mCyclesPerFrame, const uint8 checks = all);
+
+private:
+  void runTo(const uint64_t cycle); //stops early when the first side ends a frame
+  bool frameEnded(const size_t index) const;
+  std::string compare(const uint8 checks);
+
+  Configuration m_configurations[2];
+  std::unique_ptr<Gameboy> m_gameboys[2];
+  InputMovie m_movie;
+  uint64_t m_cycle;
+  uint64_t m_frame; //frames the first side finished, the movie index
+};
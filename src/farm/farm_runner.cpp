@@ -0,0 +1,109 @@
+#include "farm/farm_runner.h"
+#include "library/rom_library.h"
+#include <chrono>
+#include <iostream>
+
+uint64_t FarmRunner::Stats::frames() const
+{
+  return mCycles / Gameboy::mCyclesPerFrame;
+}
+
+double FarmRunner::Stats::framesPerSecond() const
+{
+  return seconds > 0 ? (static_cast<double>(mCycles) / Gameboy::mCyclesPerFrame) / seconds : 0;
+}
+
+double FarmRunner::Stats::speed() const
+{
+  constexpr double gameboyFps{59.7275};
+  return framesPerSecond() / gameboyFps;
+}
+
+FarmRunner::FarmRunner(unsigned int threads)
+  : m_instances{}
+  , m_pool{threads}
+  , m_mCycles{}
+  , m_tasks{}
+  , m_stealsAtReset{}
+  , m_seconds{}
+{
+}
+
+size_t FarmRunner::addInstance(const std::filesystem::path& romPath, const Accuracy accuracy)
+{
+  m_instances.push_back(std::make_unique<Gameboy>(nullptr));
+  m_instances.back()->openRom(romPath, accuracy);
+  return m_instances.size() - 1;
+}
+
+size_t FarmRunner::addInstance(const RomLibrary& library, uint64_t hash, const Accuracy accuracy)
+{
+  const RomLibrary::Entry* entry{library.find(hash)};
+  if(!entry)
+  {
+    m_instances.push_back(std::make_unique<Gameboy>(nullptr));
+    std::cerr << "No rom with hash " << std::hex << hash << std::dec << '\n';
+    return m_instances.size() - 1;
+  }
+  return addInstance(entry->path, accuracy);
+}
+
+Gameboy& FarmRunner::getInstance(size_t index)
+{
+  return *m_instances[index];
+}
+
+size_t FarmRunner::getInstanceCount() const
+{
+  return m_instances.size();
+}
+
+unsigned int FarmRunner::getThreadCount() const
+{
+  return m_pool.getThreadCount();
+}
+
+void FarmRunner::runFrames(uint32 frames, uint32 framesPerTask)
+{
+  runCycles(static_cast<uint64_t>(frames) * Gameboy::mCyclesPerFrame, framesPerTask * Gameboy::mCyclesPerFrame);
+}
+
+void FarmRunner::runCycles(uint64_t mCycles, uint32 mCyclesPerTask)
+{
+  if(mCycles == 0 || mCyclesPerTask == 0) return;
+
+  const auto start{std::chrono::steady_clock::now()};
+  for(auto& instance : m_instances)
+  {
+    if(instance->hasRom()) schedule(*instance, mCycles, mCyclesPerTask);
+  }
+  m_pool.waitIdle();
+  m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+FarmRunner::Stats FarmRunner::getStats() const
+{
+  return Stats{m_mCycles, m_tasks, m_pool.getStealCount() - m_stealsAtReset, m_seconds};
+}
+
+void FarmRunner::resetStats()
+{
+  m_mCycles = 0;
+  m_tasks = 0;
+  m_stealsAtReset = m_pool.getStealCount();
+  m_seconds = 0;
+}
+
+void FarmRunner::schedule(Gameboy& gameboy, uint64_t mCyclesLeft, uint32 mCyclesPerTask)
+{
+  m_pool.submit(
+    [this, &gameboy, mCyclesLeft, mCyclesPerTask]
+    {
+      const uint32 mCycles{static_cast<uint32>(std::min<uint64_t>(mCyclesLeft, mCyclesPerTask))};
+      gameboy.runCycles(mCycles);
+      m_mCycles += mCycles;
+      ++m_tasks;
+      //the continuation goes on this worker's own deque, idle workers steal it if this one falls behind
+      if(mCyclesLeft > mCycles) schedule(gameboy, mCyclesLeft - mCycles, mCyclesPerTask);
+    });
+}
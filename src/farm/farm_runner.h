@@ -0,0 +1,53 @@
+#pragma once
+#include "core/gameboy.h"
+#include "farm/thread_pool.h"
+#include "type_alias.h"
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+class RomLibrary;
+
+//owns many headless gameboys and steps them on a work-stealing pool sized to the host cores
+class FarmRunner
+{
+public:
+  struct Stats
+  {
+    uint64_t mCycles{};
+    uint64_t tasks{};
+    uint64_t steals{};
+    double seconds{};
+
+    uint64_t frames() const; //in frame-sized units of emulated time
+    double framesPerSecond() const;
+    double speed() const; //relative to a real gameboy
+  };
+
+  FarmRunner(unsigned int threads = 0);
+
+  size_t addInstance(const std::filesystem::path& romPath, const Accuracy accuracy = Accuracy::accurate);
+  //the rom with the content hash in the library, the instance stays empty if there is none
+  size_t addInstance(const RomLibrary& library, uint64_t hash, const Accuracy accuracy = Accuracy::accurate);
+  Gameboy& getInstance(size_t index);
+  size_t getInstanceCount() const;
+  unsigned int getThreadCount() const;
+
+  //every instance with a rom runs the given amount, split into tasks of at most the given size
+  void runFrames(uint32 frames, uint32 framesPerTask = 1);
+  void runCycles(uint64_t mCycles, uint32 mCyclesPerTask = Gameboy::mCyclesPerFrame);
+
+  Stats getStats() const;
+  void resetStats();
+
+private:
+  void schedule(Gameboy& gameboy, uint64_t mCyclesLeft, uint32 mCyclesPerTask);
+
+  std::vector<std::unique_ptr<Gameboy>> m_instances;
+  ThreadPool m_pool; //declared after the instances so the workers are joined before they are destroyed
+
+  std::atomic<uint64_t> m_mCycles;
+  std::atomic<uint64_t> m_tasks;
+  uint64_t m_stealsAtReset;
+  double m_seconds;
+};
@@ -0,0 +1,119 @@
+#include "farm/thread_pool.h"
+
+thread_local int ThreadPool::s_workerIndex{-1};
+
+ThreadPool::ThreadPool(unsigned int threads)
+  : m_workers{}
+  , m_threads{}
+  , m_sleepMutex{}
+  , m_wakeCondition{}
+  , m_idleCondition{}
+  , m_queuedTasks{}
+  , m_pendingTasks{}
+  , m_steals{}
+  , m_nextWorker{}
+  , m_shutdown{}
+{
+  if(threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  m_workers.reserve(threads);
+  for(unsigned int i{}; i < threads; ++i) m_workers.push_back(std::make_unique<Worker>());
+
+  m_threads.reserve(threads);
+  for(unsigned int i{}; i < threads; ++i) m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  waitIdle();
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_shutdown = true;
+  }
+  m_wakeCondition.notify_all();
+  for(auto& thread : m_threads) thread.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+  const unsigned int index{s_workerIndex >= 0 ? static_cast<unsigned int>(s_workerIndex)
+                                              : m_nextWorker.fetch_add(1, std::memory_order_relaxed) %
+                                                  static_cast<unsigned int>(m_workers.size())};
+  ++m_pendingTasks;
+  {
+    //taken so a worker can't check the counter and go to sleep between the increment and the notify
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    ++m_queuedTasks;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+    m_workers[index]->tasks.push_back(std::move(task));
+  }
+  m_wakeCondition.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+  std::unique_lock<std::mutex> lock(m_sleepMutex);
+  m_idleCondition.wait(lock, [this] { return m_pendingTasks == 0; });
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+  return static_cast<unsigned int>(m_threads.size());
+}
+
+uint64_t ThreadPool::getStealCount() const
+{
+  return m_steals;
+}
+
+void ThreadPool::workerLoop(unsigned int index)
+{
+  s_workerIndex = static_cast<int>(index);
+  while(true)
+  {
+    Task task{};
+    if(popLocal(index, task) || steal(index, task))
+    {
+      --m_queuedTasks;
+      task();
+      if(--m_pendingTasks == 0)
+      {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_idleCondition.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_wakeCondition.wait(lock, [this] { return m_queuedTasks > 0 || m_shutdown; });
+    if(m_shutdown && m_queuedTasks == 0) return;
+  }
+}
+
+bool ThreadPool::popLocal(unsigned int index, Task& task)
+{
+  Worker& worker{*m_workers[index]};
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if(worker.tasks.empty()) return false;
+  task = std::move(worker.tasks.back());
+  worker.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::steal(unsigned int thief, Task& task)
+{
+  const size_t workerCount{m_workers.size()};
+  for(size_t i{1}; i < workerCount; ++i)
+  {
+    Worker& victim{*m_workers[(thief + i) % workerCount]};
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(victim.tasks.empty()) continue;
+    task = std::move(victim.tasks.front());
+    victim.tasks.pop_front();
+    ++m_steals;
+    return true;
+  }
+  return false;
+}
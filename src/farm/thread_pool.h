@@ -0,0 +1,55 @@
+#pragma once
+#include "type_alias.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//every worker owns a deque, it pops its own tasks from the back(lifo, the state it just touched is still in cache)
+//and when it runs out it steals from the front of the other workers' deques
+class ThreadPool
+{
+public:
+  using Task = std::function<void()>;
+
+  ThreadPool(unsigned int threads = 0); //0 means one thread per host core
+  ~ThreadPool();
+
+  void submit(Task task); //from a worker thread the task goes on its own deque
+  void waitIdle();
+
+  unsigned int getThreadCount() const;
+  uint64_t getStealCount() const;
+
+private:
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void workerLoop(unsigned int index);
+  bool popLocal(unsigned int index, Task& task);
+  bool steal(unsigned int thief, Task& task);
+
+  static thread_local int s_workerIndex; //-1 outside of the pool
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeCondition;
+  std::condition_variable m_idleCondition;
+  std::atomic<uint64_t> m_queuedTasks;  //submitted but not yet picked up
+  std::atomic<uint64_t> m_pendingTasks; //submitted but not yet finished
+  std::atomic<uint64_t> m_steals;
+  std::atomic<unsigned int> m_nextWorker;
+  bool m_shutdown;
+};
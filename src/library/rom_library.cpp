@@ -0,0 +1,219 @@
+#include "library/rom_library.h"
+#include "core/cartridge/cartridge_slot.h"
+#include "core/cartridge/rom_image.h"
+#include "core/save_state.h"
+#include "farm/thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+bool RomLibrary::Entry::isSupported() const
+{
+  constexpr uint8 cgbOnly{0xC0};
+  return valid && cgbFlag != cgbOnly && CartridgeSlot::isSupported(cartridgeType);
+}
+
+bool RomLibrary::isRomFile(const std::filesystem::path& path)
+{
+  return CartridgeSlot::isRomFile(path);
+}
+
+bool RomLibrary::load(const std::filesystem::path& indexPath)
+{
+  m_entries.clear();
+  m_byHash.clear();
+  std::ifstream file{indexPath, std::ios::binary};
+  if(file.fail()) return false;
+  const std::vector<uint8> buffer{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+  StateReader index{buffer.data(), buffer.size()};
+  uint32 magic{};
+  uint32 version{};
+  uint32 count{};
+  index.read(magic);
+  index.read(version);
+  index.read(count);
+  if(index.failed() || magic != indexMagic || version != indexVersion)
+  {
+    std::cerr << indexPath << " is not a rom index of this version\n";
+    return false;
+  }
+
+  constexpr uint32 maxPathLength{4096};
+  constexpr uint32 titleLength{16};
+  std::vector<Entry> entries(count);
+  for(Entry& entry : entries)
+  {
+    uint8 valid{}; //read as a byte, any value but 0 and 1 in a bool is undefined
+    index.readContainer(entry.path, maxPathLength);
+    index.read(entry.modified);
+    index.read(entry.fileSize);
+    index.read(valid);
+    index.read(entry.hash);
+    index.readContainer(entry.title, titleLength);
+    index.read(entry.cgbFlag);
+    index.read(entry.cartridgeType);
+    index.read(entry.romSize);
+    index.read(entry.ramSize);
+    index.read(entry.headerChecksum);
+    index.read(entry.globalChecksum);
+    if(index.failed()) break;
+    if(valid > 1)
+    {
+      std::cerr << indexPath << " is corrupted\n";
+      return false;
+    }
+    entry.valid = valid != 0;
+  }
+  if(index.failed())
+  {
+    std::cerr << indexPath << " is truncated\n";
+    return false;
+  }
+  m_entries = std::move(entries);
+  rebuildHashes();
+  return true;
+}
+
+bool RomLibrary::save(const std::filesystem::path& indexPath) const
+{
+  std::vector<uint8> buffer{};
+  StateWriter index{buffer};
+  index.write(indexMagic);
+  index.write(indexVersion);
+  index.write(static_cast<uint32>(m_entries.size()));
+  for(const Entry& entry : m_entries)
+  {
+    index.writeContainer(entry.path);
+    index.write(entry.modified);
+    index.write(entry.fileSize);
+    index.write(static_cast<uint8>(entry.valid));
+    index.write(entry.hash);
+    index.writeContainer(entry.title);
+    index.write(entry.cgbFlag);
+    index.write(entry.cartridgeType);
+    index.write(entry.romSize);
+    index.write(entry.ramSize);
+    index.write(entry.headerChecksum);
+    index.write(entry.globalChecksum);
+  }
+
+  //written next to the index and renamed over it, an interrupted save leaves the old index
+  std::filesystem::path temporary{indexPath};
+  temporary += ".tmp";
+  {
+    std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    file.close();
+    if(file.fail())
+    {
+      std::cerr << "Couldn't write rom index " << temporary << '\n';
+      return false;
+    }
+  }
+  std::error_code error{};
+  std::filesystem::rename(temporary, indexPath, error);
+  if(error)
+  {
+    std::cerr << "Couldn't replace rom index " << indexPath << ": " << error.message() << '\n';
+    return false;
+  }
+  return true;
+}
+
+RomLibrary::ScanStats RomLibrary::scan(const std::filesystem::path& root, unsigned int threads)
+{
+  const auto start{std::chrono::steady_clock::now()};
+  ScanStats stats{};
+
+  std::unordered_map<std::string, Entry> known{};
+  for(Entry& entry : m_entries) known.emplace(entry.path, std::move(entry));
+  m_entries.clear();
+
+  //files that are unchanged keep their entry, the rest are read afterwards
+  std::vector<size_t> changed{};
+  std::error_code error{};
+  std::filesystem::recursive_directory_iterator file{root, std::filesystem::directory_options::skip_permission_denied,
+                                                     error};
+  if(error) std::cerr << "Couldn't scan " << root << ": " << error.message() << '\n';
+  for(; !error && file != std::filesystem::recursive_directory_iterator{}; file.increment(error))
+  {
+    std::error_code fileError{};
+    if(!file->is_regular_file(fileError) || !isRomFile(file->path())) continue;
+    Entry entry{};
+    entry.path = file->path().generic_string();
+    entry.modified = static_cast<int64_t>(file->last_write_time(fileError).time_since_epoch().count());
+    entry.fileSize = file->file_size(fileError);
+    if(fileError) continue;
+
+    const auto old{known.find(entry.path)};
+    if(old != known.end() && old->second.modified == entry.modified && old->second.fileSize == entry.fileSize)
+      m_entries.push_back(std::move(old->second));
+    else
+    {
+      changed.push_back(m_entries.size());
+      m_entries.push_back(std::move(entry));
+    }
+    if(old != known.end()) known.erase(old);
+  }
+  stats.removed = known.size();
+  stats.read = changed.size();
+
+  {
+    ThreadPool pool{threads};
+    for(const size_t index : changed) pool.submit([this, index] { describe(m_entries[index]); });
+  } //the pool finishes its tasks before joining
+
+  std::sort(m_entries.begin(), m_entries.end(),
+            [](const Entry& left, const Entry& right) { return left.path < right.path; });
+  rebuildHashes();
+  for(const Entry& entry : m_entries)
+  {
+    if(entry.valid) ++stats.roms;
+    else ++stats.invalid;
+  }
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+void RomLibrary::describe(Entry& entry)
+{
+  std::shared_ptr<const RomImage> image{RomImage::map(entry.path)};
+  entry.valid = image != nullptr;
+  if(!image) return;
+
+  const uint8* header{image->data()};
+  constexpr uint16 titleAddress{0x134};
+  constexpr uint16 cgbFlagAddress{0x143};
+  //ends at the first zero, or at the cgb flag and manufacturer code of newer headers
+  const auto titleEnd{std::find_if(header + titleAddress, header + cgbFlagAddress + 1,
+                                   [](uint8 character) { return character == 0 || character >= 0x80; })};
+  entry.title.assign(header + titleAddress, titleEnd);
+  entry.cgbFlag = header[cgbFlagAddress];
+  entry.cartridgeType = header[0x147];
+  entry.romSize = header[0x148];
+  entry.ramSize = header[0x149];
+  entry.headerChecksum = header[0x14D];
+  entry.globalChecksum = image->getChecksum();
+  entry.hash = RomImage::hash(image->data(), image->size());
+}
+
+void RomLibrary::rebuildHashes()
+{
+  m_byHash.clear();
+  for(size_t i{}; i < m_entries.size(); ++i)
+    if(m_entries[i].valid) m_byHash.emplace(m_entries[i].hash, i); //the first path wins for duplicates
+}
+
+const RomLibrary::Entry* RomLibrary::find(uint64_t hash) const
+{
+  const auto entry{m_byHash.find(hash)};
+  return entry != m_byHash.end() ? &m_entries[entry->second] : nullptr;
+}
+
+const std::vector<RomLibrary::Entry>& RomLibrary::getEntries() const
+{
+  return m_entries;
+}
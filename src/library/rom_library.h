@@ -0,0 +1,61 @@
+#pragma once
+#include "type_alias.h"
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//index of the roms under a directory: header fields and content hash of every file, kept in a compact file so jobs can
+//resolve roms by hash and check their cartridge type without opening them. a scan only reads files that are new or
+//whose modification time or size changed since the index was saved
+class RomLibrary
+{
+public:
+  struct Entry
+  {
+    std::string path{}; //generic form
+    int64_t modified{}; //file time ticks
+    uint64_t fileSize{};
+    bool valid{}; //invalid files are kept too so they aren't read again until they change
+    uint64_t hash{}; //RomImage::hash of the declared rom size
+    std::string title{};
+    uint8 cgbFlag{};       //0x143, also the last title byte on older roms
+    uint8 cartridgeType{}; //0x147
+    uint8 romSize{};       //0x148 size code
+    uint8 ramSize{};       //0x149 size code
+    uint8 headerChecksum{};
+    uint16 globalChecksum{};
+
+    bool isSupported() const; //valid, runs on a dmg and of a cartridge type the emulator knows
+  };
+
+  struct ScanStats
+  {
+    size_t roms{};
+    size_t invalid{};
+    size_t read{};    //files that were new or changed
+    size_t removed{}; //entries whose file is gone
+    double seconds{};
+  };
+
+  bool load(const std::filesystem::path& indexPath); //false if missing or of another version, the index stays empty
+  bool save(const std::filesystem::path& indexPath) const;
+
+  //brings the index up to date with the roms under root, changed files are read on a pool of the given size
+  ScanStats scan(const std::filesystem::path& root, unsigned int threads = 0);
+
+  const Entry* find(uint64_t hash) const; //null if no valid rom has the hash
+  const std::vector<Entry>& getEntries() const; //sorted by path
+
+  static bool isRomFile(const std::filesystem::path& path);
+
+private:
+  static constexpr uint32 indexMagic{0x494C4242}; //"BBLI" as little endian bytes
+  static constexpr uint32 indexVersion{1};
+
+  static void describe(Entry& entry); //reads the file
+  void rebuildHashes();
+
+  std::vector<Entry> m_entries;
+  std::unordered_map<uint64_t, size_t> m_byHash;
+};
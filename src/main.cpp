@@ -1,12 +1,193 @@
+#include "config.h"
 #include "core/gameboy.h"
+#include "core/heatmap.h"
+#include "diff/diff_runner.h"
+#include "farm/farm_runner.h"
+#include "library/rom_library.h"
 #include "platform.h"
+#include <charconv>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+
+//the optional numeric argument at index keeps its default when it's missing, false if it isn't a number that fits
+template<typename Number>
+static bool parseArgument(int argc, char** argv, int index, Number& value, int base = 10)
+{
+  if(argc <= index) return true;
+  const std::string_view text{argv[index]};
+  const auto [end, error]{std::from_chars(text.data(), text.data() + text.size(), value, base)};
+  return error == std::errc{} && end == text.data() + text.size();
+}
+
+static int usage(const char* line)
+{
+  std::cerr << "Usage: " << line << '\n';
+  return 1;
+}
+
+//bboy --farm <rom> [instances] [frames] [threads] [index], with an index the rom is given by its content hash
+static int runFarm(int argc, char** argv)
+{
+  size_t instances{1};
+  uint32 frames{600};
+  unsigned int threads{};
+  uint64_t hash{};
+  if(!parseArgument(argc, argv, 3, instances) || !parseArgument(argc, argv, 4, frames) ||
+     !parseArgument(argc, argv, 5, threads) || (argc > 6 && !parseArgument(argc, argv, 2, hash, 16)))
+    return usage("bboy --farm <rom | hash> [instances] [frames] [threads] [index]");
+
+  RomLibrary library{};
+  if(argc > 6)
+  {
+    if(!library.load(argv[6])) return 1;
+    if(!library.find(hash))
+    {
+      std::cerr << "No rom with hash " << argv[2] << '\n';
+      return 1;
+    }
+  }
+
+  FarmRunner farm{threads};
+  const Accuracy accuracy{Config::getInstance().getAccuracy()};
+  for(size_t i{}; i < instances; ++i)
+  {
+    if(argc > 6) farm.addInstance(library, hash, accuracy);
+    else farm.addInstance(argv[2], accuracy);
+  }
+  farm.runFrames(frames);
+
+  const FarmRunner::Stats stats{farm.getStats()};
+  std::cout << instances << " instances on " << farm.getThreadCount() << " threads: " << stats.frames()
+            << " frames in " << stats.seconds << "s, " << stats.framesPerSecond() << " fps (" << stats.speed()
+            << "x), " << stats.tasks << " tasks, " << stats.steals << " steals\n";
+  return 0;
+}
+
+//bboy --diff <rom> [frames] [checkpoint m-cycles] [movie], accurate against fast profile
+static int runDiff(int argc, char** argv)
+{
+  uint32 frames{600};
+  uint32 checkpointCycles{Gameboy::mCyclesPerFrame};
+  if(!parseArgument(argc, argv, 3, frames) || !parseArgument(argc, argv, 4, checkpointCycles))
+    return usage("bboy --diff <rom> [frames] [checkpoint m-cycles] [movie]");
+
+  DiffRunner diff{{"accurate", Accuracy::accurate}, {"fast", Accuracy::fast}};
+  if(!diff.openRom(argv[2])) return 1;
+  if(argc > 5)
+  {
+    InputMovie movie{};
+    if(!movie.load(argv[5])) return 1;
+    diff.setMovie(movie);
+  }
+
+  const DiffRunner::Divergence divergence{diff.run(frames, checkpointCycles)};
+  if(!divergence.found)
+  {
+    std::cout << "no divergence in " << frames << " frames\n";
+    return 0;
+  }
+
+  std::cout << (divergence.exact ? "diverged" : "diverged by checkpoint") << " at m-cycle " << divergence.cycle << " (frame "
+            << divergence.frame << " cycle " << divergence.frameCycle << ")\n"
+            << "  " << divergence.description << '\n'
+            << std::hex << "  pc " << diff.getConfiguration(0).name << " " << divergence.pc[0] << ", "
+            << diff.getConfiguration(1).name << " " << divergence.pc[1] << '\n';
+  return 1;
+}
+
+//bboy --heatmap <rom> [frames] [dump] [per-frame], needs a build with the BBOY_HEATMAP option
+static int runHeatmap([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
+{
+#ifdef BBOY_HEATMAP
+  uint32 frames{600};
+  if(!parseArgument(argc, argv, 3, frames)) return usage("bboy --heatmap <rom> [frames] [dump] [per-frame]");
+  const std::filesystem::path dump{argc > 4 ? argv[4] : "heatmap.bin"};
+  const bool perFrame{argc > 5 && std::string_view{argv[5]} != "0"};
+
+  Gameboy gameboy{nullptr};
+  gameboy.setDeterministic(true);
+  gameboy.openRom(argv[2], Config::getInstance().getAccuracy());
+  if(!gameboy.hasRom()) return 1;
+
+  Heatmap& heatmap{gameboy.getBus().getHeatmap()};
+  if(perFrame && !heatmap.startFrameDump(dump)) return 1;
+  for(uint32 i{}; i < frames; ++i) gameboy.frame();
+  if(!perFrame && !heatmap.save(dump, gameboy.currentCycle())) return 1;
+  return Heatmap::report(dump, std::cout) ? 0 : 1;
+#else
+  std::cerr << "Access counting is compiled out, configure with -DBBOY_HEATMAP=ON\n";
+  return 1;
+#endif
+}
+
+//bboy --heatmap-report <dump> [lines]
+static int runHeatmapReport(int argc, char** argv)
+{
+  size_t lines{16};
+  if(!parseArgument(argc, argv, 3, lines)) return usage("bboy --heatmap-report <dump> [lines]");
+  return Heatmap::report(argv[2], std::cout, lines) ? 0 : 1;
+}
+
+//bboy --index <rom directory> [index] [threads], the index defaults to bboy.index in the directory
+static int runIndex(int argc, char** argv)
+{
+  const std::filesystem::path root{argv[2]};
+  const std::filesystem::path indexPath{argc > 3 ? std::filesystem::path{argv[3]} : root / "bboy.index"};
+  unsigned int threads{};
+  if(!parseArgument(argc, argv, 4, threads)) return usage("bboy --index <rom directory> [index] [threads]");
+
+  RomLibrary library{};
+  library.load(indexPath);
+  const RomLibrary::ScanStats stats{library.scan(root, threads)};
+  if(!library.save(indexPath)) return 1;
+  std::cout << stats.roms << " roms, " << stats.invalid << " invalid files, " << stats.read << " read, "
+            << stats.removed << " removed in " << stats.seconds << "s\n";
+  return 0;
+}
+
+//bboy --lookup <index> [hash], prints the rom with the content hash or lists every rom with its hash
+static int runLookup(int argc, char** argv)
+{
+  uint64_t hash{};
+  if(!parseArgument(argc, argv, 3, hash, 16)) return usage("bboy --lookup <index> [hash]");
+  RomLibrary library{};
+  if(!library.load(argv[2])) return 1;
+  std::cout << std::hex << std::setfill('0');
+  if(argc < 4)
+  {
+    for(const RomLibrary::Entry& entry : library.getEntries())
+      if(entry.valid) std::cout << std::setw(16) << entry.hash << ' ' << entry.path << '\n';
+    return 0;
+  }
+
+  const RomLibrary::Entry* entry{library.find(hash)};
+  if(!entry)
+  {
+    std::cerr << "No rom with hash " << argv[3] << '\n';
+    return 1;
+  }
+  std::cout << entry->path << "\n  title \"" << entry->title << "\", type " << std::setw(2) << +entry->cartridgeType
+            << (entry->isSupported() ? "" : " (unsupported)") << ", rom size " << std::setw(2) << +entry->romSize
+            << ", ram size " << std::setw(2) << +entry->ramSize << ", checksum " << std::setw(4) << entry->globalChecksum
+            << '\n';
+  return 0;
+}
 
 int main(int argc, char** argv)
 {
+  if(argc > 2 && std::string_view{argv[1]} == "--farm") return runFarm(argc, argv);
+  if(argc > 2 && std::string_view{argv[1]} == "--diff") return runDiff(argc, argv);
+  if(argc > 2 && std::string_view{argv[1]} == "--heatmap") return runHeatmap(argc, argv);
+  if(argc > 2 && std::string_view{argv[1]} == "--heatmap-report") return runHeatmapReport(argc, argv);
+  if(argc > 2 && std::string_view{argv[1]} == "--index") return runIndex(argc, argv);
+  if(argc > 2 && std::string_view{argv[1]} == "--lookup") return runLookup(argc, argv);
+
   Platform& platform = Platform::getInstance();
   {
     Gameboy gameboy;
-    if(argc == 2) gameboy.openRom(argv[1]);
+    if(argc == 2 || argc == 3) //bboy <rom> [patch]
+      gameboy.openRom(argv[1], Config::getInstance().getAccuracy(), argc == 3 ? argv[2] : "");
     platform.mainLoop(gameboy);
   }
   SDL_Quit();
@@ -1,4 +1,5 @@
 #include "platform.h"
+#include "config.h"
 #include "core/gameboy.h"
 #include <SDL3/SDL_opengl.h>
 #include <SDL3/SDL_timer.h>
@@ -55,7 +56,7 @@ void Platform::mainLoop(Gameboy& gameboy)
       switch(m_event.type)
       {
       case SDL_EVENT_QUIT:      m_running = false; break;
-      case SDL_EVENT_DROP_FILE: gameboy.openRom(m_event.drop.data); break;
+      case SDL_EVENT_DROP_FILE: gameboy.openRom(m_event.drop.data, Config::getInstance().getAccuracy()); break;
       case SDL_EVENT_KEY_DOWN:
         if(m_event.key.scancode == SDL_SCANCODE_SPACE) fpsLimit = !fpsLimit;
         else if(m_event.key.scancode == SDL_SCANCODE_BACKSPACE) gameboy.hardReset();